@@ -0,0 +1,52 @@
+#include "Advisor.h"
+#include "SkiRental.h"
+
+#include <numeric>
+
+namespace IndexUpdate {
+
+    Advisor::Advisor(const Settings& s) :
+            settings(s), cache(s),
+            seenPostings(0), postingsInUpdateBuffer(0), tombstonesInUpdateBuffer(0), queries(0) {
+        for(unsigned i = 0; i < settings.tpMembers.size(); ++i)
+            tpacks.emplace_back(TermPack(i, settings.tpMembers[i]));
+        cache.init(tpacks);
+
+        const uint64_t maxReserved = 1 << 20;
+        auto terms = std::accumulate(settings.tpMembers.begin(), settings.tpMembers.end(), uint64_t(0));
+        cache.cache.reserve(std::min(terms, maxReserved));
+    }
+
+    MergeAdvice Advisor::recommendConsolidation(unsigned packId) {
+        TermPack& tp = tpacks[packId];
+        tombstonesInUpdateBuffer -= tp.bufferedTombstones();
+        auto newPostings = tp.flush();
+        seenPostings += newPostings;
+        postingsInUpdateBuffer -= newPostings;
+
+        MergeAdvice advice;
+        advice.segments = tp.segments().size();
+        //the ski-rental offset, unless the garbage calls for a compaction from the bottom
+        const auto offset = skiRentalOffset(tp, settings, priceScratch);
+        advice.compaction = needsCompaction(tp, settings);
+        advice.firstSegment = consolidationOffset(tp, offset, settings);
+        advice.cost = consolidateTP(tp, offset, settings);
+        merges += advice.cost;
+        return advice;
+    }
+
+    CostSnapshot Advisor::snapshot() const {
+        CostSnapshot snap;
+        snap.seenPostings = seenPostings;
+        snap.bufferedPostings = postingsInUpdateBuffer;
+        snap.queries = queries;
+        snap.cacheHits = cache.cache.cacheHits;
+        snap.queryReads = queryReads;
+        snap.merges = merges;
+        snap.queryMinutes = costIoInMinutes(queryReads,
+                                            settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+        snap.mergeMinutes = ConsolidationStats::costInMinutes(merges,
+                                            settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+        return snap;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef UPDATE_LITE_ADVISOR_H
+#define UPDATE_LITE_ADVISOR_H
+
+#include "Settings.h"
+#include "TermPack.h"
+#include "Landlord.h"
+#include "SimulateCache.h"
+#include "SkiRental.h"
+
+namespace IndexUpdate {
+
+    //running totals of the modeled costs
+    struct CostSnapshot {
+        uint64_t seenPostings; //flushed from the update buffer
+        uint64_t bufferedPostings;
+        uint64_t queries;
+        uint64_t cacheHits;
+        ReadIO queryReads;
+        ConsolidationStats merges;
+        double queryMinutes;
+        double mergeMinutes;
+    };
+
+    //what to do with the segments of a pack that was just flushed
+    struct MergeAdvice {
+        unsigned firstSegment; //consolidate all the segments from this one on...
+        unsigned segments; //...out of that many (the new one included)
+        bool compaction; //above the garbage trigger: from segment 0 on, even a single one
+        ConsolidationStats cost;
+
+        bool consolidate() const { return compaction || firstSegment+1 < segments; }
+    };
+
+    //the simulator's cost model as an incremental advisor for a live indexer.
+    //onUpdates/onQuery are constant time (plus a cache visit) and don't allocate
+    //once the cache has reached its working size; the model assumes its advice is followed
+    class Advisor {
+        const Settings settings;
+        std::vector<TermPack> tpacks;
+        SimulateCache<Caching::StaticLandlord> cache;
+
+        uint64_t seenPostings;
+        uint64_t postingsInUpdateBuffer;
+        uint64_t tombstonesInUpdateBuffer; //they take room too (settings.deletes)
+        uint64_t queries;
+        ReadIO queryReads;
+        ConsolidationStats merges;
+        PriceScratch priceScratch;
+    public:
+        //uses the disk, buffer and cache sizes and tpMembers of settings
+        explicit Advisor(const Settings& s);
+
+        void onUpdates(unsigned packId, uint64_t postings) {
+            tpacks[packId].addUBPostings(postings);
+            postingsInUpdateBuffer += postings;
+        }
+
+        //deletes of that many postings of the pack; those already on disk get tombstones
+        void onDeletes(unsigned packId, double postings) {
+            tombstonesInUpdateBuffer += tpacks[packId].addDeletes(postings);
+        }
+
+        //true if the cache served the query
+        bool onQuery(unsigned packId) {
+            ++queries;
+            TermPack& tp = tpacks[packId];
+            if(cache.visit(packId, tp.liveDiskLength()))
+                return true;
+            queryReads += tp.query();
+            return false;
+        }
+
+        bool shouldEvict() const {
+            return postingsInUpdateBuffer + tombstonesInUpdateBuffer >= settings.updateBufferPostingsLimit;
+        }
+
+        //the buffered postings of the pack go to disk as a new segment; the advice says
+        //which suffix of the pack's segments the ski-rental policy consolidates with it
+        MergeAdvice recommendConsolidation(unsigned packId);
+
+        CostSnapshot snapshot() const;
+
+        const TermPack& pack(unsigned packId) const { return tpacks[packId]; }
+        size_t packs() const { return tpacks.size(); }
+    };
+}
+
+#endif //UPDATE_LITE_ADVISOR_H
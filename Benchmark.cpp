@@ -0,0 +1,92 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+#include "Simulator.h"
+#include "Profiles.h"
+#include "Advisor.h"
+
+using namespace IndexUpdate;
+
+typedef double (*SimulateF)(Algorithm, const Settings&);
+
+//best of few runs, in ms
+static double timeIt(SimulateF f, Algorithm alg, const Settings& settings, double& minutes, unsigned runs = 5) {
+    double best = 0;
+    for(unsigned i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        minutes = f(alg, settings);
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        if(!i || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+//per-event latency of the incremental advisor, in ns
+static void benchAdvisor(DiskType disk) {
+    Settings settings = Profiles::training(disk);
+    settings.updateBufferPostingsLimit = 1ull << 30;
+    settings.cacheSizePostings = 1ull << 26;
+    Advisor advisor(settings);
+    const unsigned packs = advisor.packs();
+    const unsigned events = 1u << 22;
+
+    double updateNs = 0, queryNs = 0;
+    unsigned flushes = 0;
+    for(unsigned round = 0; round < 8; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for(unsigned i = 0; i < events; ++i)
+            advisor.onUpdates(i % packs, 64);
+        auto mid = std::chrono::steady_clock::now();
+        for(unsigned i = 0; i < events; ++i)
+            advisor.onQuery(i % packs);
+        auto end = std::chrono::steady_clock::now();
+        updateNs += std::chrono::duration<double, std::nano>(mid - start).count();
+        queryNs += std::chrono::duration<double, std::nano>(end - mid).count();
+
+        for(unsigned id = packs; advisor.shouldEvict() && id; --id, ++flushes)
+            advisor.recommendConsolidation(id-1);
+    }
+    auto snap = advisor.snapshot();
+    std::cout << "Advisor " << (disk == HD ? "HD " : "SSD")
+              << " onUpdates-ns: " << updateNs / (8.0*events)
+              << " onQuery-ns: " << queryNs / (8.0*events)
+              << " flushes: " << flushes
+              << " query-minutes: " << snap.queryMinutes
+              << " merge-minutes: " << snap.mergeMinutes << std::endl;
+}
+
+int main(int argc, char** argv) {
+    unsigned queries = (argc >= 2) ? atoi(argv[1]) : 64;
+    uint64_t totalPostings = 1000ull*1000ull*((argc >= 3) ? atoi(argv[2]) : 8000);
+    unsigned bufferPct = (argc >= 4) ? atoi(argv[3]) : 99; //of the memory, the rest is the cache
+
+    for(auto disk : {HD, SSD}) {
+        Settings settings = Profiles::training(disk, queries);
+        settings.totalExperimentPostings = totalPostings;
+        settings.flags[0] = bufferPct;
+        settings.flags[1] = settings.percentsUBLeft;
+        const auto ubsz = (1ull << 32);
+        settings.updateBufferPostingsLimit = (ubsz * settings.flags[0]) / 100;
+        settings.cacheSizePostings = ubsz - settings.updateBufferPostingsLimit;
+
+        for(auto alg : {SkiBased, LogMerge}) {
+            //the same engine: the algorithm branched on at run time and a virtual cache,
+            //or the algorithm a template argument and the CRTP cache
+            double dynamicMinutes = 0, staticMinutes = 0;
+            double dynamicMs = timeIt(Simulator::simulateOne, alg, settings, dynamicMinutes);
+            double staticMs = timeIt(Simulator::simulateSpecialized, alg, settings, staticMinutes);
+            std::cout << Settings::name(alg) << ' ' << (disk == HD ? "HD " : "SSD")
+                      << " dynamic-ms: " << dynamicMs
+                      << " specialized-ms: " << staticMs
+                      << " speedup: " << dynamicMs / staticMs
+                      << (dynamicMinutes == staticMinutes ? " (same results)" : " (RESULTS DIFFER)")
+                      << std::endl;
+        }
+    }
+    for(auto disk : {HD, SSD})
+        benchAdvisor(disk);
+    return 0;
+}
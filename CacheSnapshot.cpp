@@ -0,0 +1,94 @@
+#include "CacheSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Caching {
+
+    SnapshotHeader SnapshotHeader::current() {
+        SnapshotHeader header;
+        std::memcpy(header.magic, "ULCS", 4);
+        header.version = 1;
+        header.entryBytes = sizeof(SnapshotEntry);
+        header.cursors = 0;
+        header.entries = 0;
+        header.accumulator = 0;
+        return header;
+    }
+
+    bool SnapshotHeader::valid() const {
+        const SnapshotHeader expected = current();
+        return !std::memcmp(magic, expected.magic, 4) && version == expected.version &&
+               entryBytes == expected.entryBytes;
+    }
+
+    void writeSnapshot(const std::string& path, uint64_t accumulator,
+                       const std::vector<SnapshotEntry>& entries, const std::vector<unsigned>& cursors) {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if(!file)
+            throw std::runtime_error("cannot write the cache snapshot " + path);
+        SnapshotHeader header = SnapshotHeader::current();
+        header.cursors = uint32_t(cursors.size());
+        header.entries = entries.size();
+        header.accumulator = accumulator;
+        const std::vector<uint32_t> cursors32(cursors.begin(), cursors.end());
+        const bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                             std::fwrite(entries.data(), sizeof(SnapshotEntry), entries.size(), file) == entries.size() &&
+                             std::fwrite(cursors32.data(), sizeof(uint32_t), cursors32.size(), file) == cursors32.size();
+        if(std::fclose(file) || !written)
+            throw std::runtime_error("cannot write the cache snapshot " + path);
+    }
+
+    MappedSnapshot::MappedSnapshot(const std::string& path) : data(nullptr), bytes(0), mapped(false) {
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if(fd >= 0 && !fstat(fd, &st) && st.st_size >= off_t(sizeof(SnapshotHeader))) {
+            void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED) {
+                data = static_cast<const unsigned char*>(p);
+                bytes = size_t(st.st_size);
+                mapped = true;
+            }
+        }
+        if(fd >= 0)
+            close(fd);
+#endif
+        if(!mapped) {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if(!in)
+                throw std::runtime_error("cannot read the cache snapshot " + path);
+            bytes = size_t(in.tellg());
+            copy.resize((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            in.seekg(0);
+            if(!in.read(reinterpret_cast<char*>(copy.data()), std::streamsize(bytes)))
+                throw std::runtime_error("cannot read the cache snapshot " + path);
+            data = reinterpret_cast<const unsigned char*>(copy.data());
+        }
+        if(bytes < sizeof(SnapshotHeader) || !header().valid() ||
+           bytes != sizeof(SnapshotHeader) + header().entries * sizeof(SnapshotEntry) +
+                    header().cursors * sizeof(uint32_t)) {
+            unmap(); //no destructor after a throw
+            throw std::runtime_error("not a (whole) cache snapshot: " + path);
+        }
+    }
+
+    MappedSnapshot::~MappedSnapshot() { unmap(); }
+
+    void MappedSnapshot::unmap() {
+#if defined(__unix__) || defined(__APPLE__)
+        if(mapped)
+            munmap(const_cast<unsigned char*>(data), bytes);
+#endif
+        mapped = false;
+    }
+}
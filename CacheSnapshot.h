@@ -0,0 +1,63 @@
+#ifndef CACHING_CACHESNAPSHOT_H
+#define CACHING_CACHESNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Caching {
+
+    //a cached term (or a ghost, of length 0) as saved by LandlordPolicy::save
+    struct SnapshotEntry {
+        uint32_t term;
+        uint32_t hitCount;
+        uint64_t length;
+        uint64_t L;
+    };
+
+    //a snapshot file is this header, the entries by (L, term) and then the cursors (the next
+    //member each pack's queries visit, see IndexUpdate::SimulateCache); all fixed size and
+    //8-byte aligned, so a mapped file is used in place
+    struct SnapshotHeader {
+        char magic[4]; //ULCS
+        uint32_t version;
+        uint32_t entryBytes;
+        uint32_t cursors;
+        uint64_t entries;
+        uint64_t accumulator; //the landlord's clock
+
+        static SnapshotHeader current();
+        bool valid() const;
+    };
+
+    //throws std::runtime_error if path cannot be written
+    void writeSnapshot(const std::string& path, uint64_t accumulator,
+                       const std::vector<SnapshotEntry>& entries, const std::vector<unsigned>& cursors);
+
+    //a snapshot file mapped into memory (read whole where mmap is not available)
+    class MappedSnapshot {
+        const unsigned char* data;
+        size_t bytes;
+        bool mapped;
+        std::vector<uint64_t> copy; //without mmap; uint64_t keeps it aligned
+
+        void unmap();
+    public:
+        //throws std::runtime_error if path cannot be read, is not a snapshot or is truncated
+        explicit MappedSnapshot(const std::string& path);
+        ~MappedSnapshot();
+
+        MappedSnapshot(const MappedSnapshot&) = delete;
+        MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+        const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(data); }
+        const SnapshotEntry* begin() const {
+            return reinterpret_cast<const SnapshotEntry*>(data + sizeof(SnapshotHeader));
+        }
+        const SnapshotEntry* end() const { return begin() + header().entries; }
+        const uint32_t* cursors() const { return reinterpret_cast<const uint32_t*>(end()); }
+    };
+}
+
+#endif //CACHING_CACHESNAPSHOT_H
@@ -9,58 +9,29 @@ namespace Caching {
 
 
 //==============================================================================================
-    class BaseCache::BaseCacheIMPL {
-    public:
-        std::unordered_map<term_t, Term*> lookupTable;
-        Term *lookup(term_t term) {
-            auto it = lookupTable.find(term);
-            return (it == lookupTable.end()) ?
-                                nullptr :  it->second;
-        }
-
-        Term* placeNew(term_t term, size_t length) {
-            Term *t = new Term();
-            t->term = term;
-            t->length = length;
-            lookupTable[term] = t;
-            return t;
-        }
-
-        inline void evict(term_t term) {
-            auto it = lookupTable.find(term);
-            assert(it != lookupTable.end());
-            if(it->second->hitCount < 3) { //higher values => smaller lookup table, closer to vanilla
-                delete it->second;
-                lookupTable.erase(it);
-            }
-            else
-                it->second->length = 0;
-        }
-
-        size_t tableSz() const { return lookupTable.size(); }
-        size_t size() const { return std::count_if(lookupTable.begin(),lookupTable.end(),
-                                                   [](std::unordered_map<term_t, Term*>::const_reference val)
-                                                   { return val.second->length > 0;}); }
+    class BaseCache::BaseCacheIMPL : public LookupTable {
     };
 //==============================================================================================
     size_t BaseCache::size() const { return baseimpl->size(); }
     Term* BaseCache::lookup(term_t term) const {return baseimpl->lookup(term); }
     Term* BaseCache::placeNew(term_t term, size_t length) { return baseimpl->placeNew(term,length); }
+    void BaseCache::entries(std::vector<const Term*>& out) const { baseimpl->entries(out); }
     void BaseCache::evict(term_t t) { return baseimpl->evict(t);}
+    bool BaseCache::admits(term_t candidate, term_t victim) const { return baseimpl->admits(candidate, victim); }
+    void BaseCache::useFrequencySketch(size_t expectedTerms) { baseimpl->useFrequencySketch(expectedTerms); }
+    void BaseCache::reserve(size_t terms) { baseimpl->reserve(terms); }
 
     BaseCache::BaseCache() :
-            cacheHits(0),cachePostingsServed(0),
-            cachePostingsMissed(0),cacheRejected(0),
             baseimpl(new BaseCacheIMPL()){}
     BaseCache::~BaseCache() { delete baseimpl; }
 
+    //a policy holding more than maxP trims it on its next miss (LandlordPolicy trims right away)
     void BaseCache::setMaxPostings(size_t maxP) {
-        if(maxPostings)
-            throw("can't resize cache in this implementation");
         maxPostings = maxP;
     }
 
     bool BaseCache::visit(unsigned term, size_t length) {
+        baseimpl->recordAccess(term);
         auto tptr = BaseCache::lookup(term);
         if(tptr && tptr->length) { //hit
             ++cacheHits;
@@ -82,18 +53,44 @@ namespace Caching {
         return false;
     }
 
-    void BaseCache::report(std::ostream& out, unsigned totalQs)const {
+    void BaseCache::visitBatch(const TermVisit* begin, const TermVisit* end, BatchResult& result) {
+        result.hits.assign(end-begin, false);
+        const auto served = cachePostingsServed;
+        const auto missed = cachePostingsMissed;
+        beginBatch();
+        for(auto it = begin; it != end; ++it) {
+            if(end - it > prefetchDistance)
+                baseimpl->prefetch(it[prefetchDistance].first);
+            result.hits[it-begin] = BaseCache::visit(it->first, it->second);
+        }
+        endBatch();
+        result.postingsServed = cachePostingsServed - served;
+        result.postingsMissed = cachePostingsMissed - missed;
+    }
+
+    void BaseCache::report(std::ostream& out, unsigned totalQs, bool endLine)const {
+        CacheCounters::report(out, name(), getTotalP(), size(), baseimpl->tableSz(), baseimpl->bytes(),
+                              baseimpl->admissionEnabled(), totalQs, endLine);
+    }
+
+    void CacheCounters::report(std::ostream& out, const std::string& name, size_t totalP,
+                               size_t members, size_t tableSz, size_t tableBytes, bool admission,
+                               unsigned totalQs, bool endLine) const {
         //size_t acc = 0; for(auto t: baseimpl->lookupTable ) acc += t.second.length; //expect_eq getTotalP()
-        out << name()
+        out << name
             << " hits: " << std::setw(9) << cacheHits
             << " hit-pct: " << std::setw(5) << std::fixed << std::setprecision(2)  << double(cacheHits)/double(totalQs) * 100.0
-            << " size: " << std::setw(14) << getTotalP()
-            << " members: " << std::setw(4) << size() << '(' << baseimpl->tableSz() << ')'
-            << " rejects: " << std::setw(6) << cacheRejected
-            << " postings-served: " << std::setw(14) << cachePostingsServed
+            << " size: " << std::setw(14) << totalP
+            << " members: " << std::setw(4) << members << '(' << tableSz << ')'
+            << " rejects: " << std::setw(6) << cacheRejected;
+        if(admission)
+            out << " not-admitted: " << std::setw(6) << cacheNotAdmitted
+                << " table-bytes: " << std::setw(10) << tableBytes;
+        out << " postings-served: " << std::setw(14) << cachePostingsServed
             << " postings-missed: " << std::setw(14) << cachePostingsMissed
-            << " srv-pct: " << std::fixed <<  std::setprecision(2) << double(cachePostingsServed)/double(cachePostingsServed+cachePostingsMissed) * 100.0
-            << std::endl;
+            << " srv-pct: " << std::fixed <<  std::setprecision(2) << double(cachePostingsServed)/double(cachePostingsServed+cachePostingsMissed) * 100.0;
+        if(endLine)
+            out << std::endl;
     }
 
-}
\ No newline at end of file
+}
@@ -5,7 +5,15 @@
 #include <unordered_map>
 #include <vector>
 #include <list>
+#include <deque>
 #include <ostream>
+#include <string>
+#include <cassert>
+#include <algorithm>
+#include <cstddef>
+
+#include "FrequencySketch.h"
+#include "MemoryAccounting.h"
 
 namespace  Caching {
     typedef unsigned term_t;
@@ -17,7 +25,12 @@ namespace  Caching {
         size_t length;
         uint64_t L;
 
-        Term() : hitCount(1) { }
+        bool detached; //out of the eviction order while a batch defers its re-insertion
+        size_t heapPos; //position in the policy's heap, notInHeap if none
+
+        static const size_t notInHeap = size_t(-1);
+
+        Term() : hitCount(1), detached(false), heapPos(notInHeap) { }
 
         inline uint64_t cost() const { return length * size_t(hitCount); }
     };
@@ -34,45 +47,308 @@ namespace  Caching {
         inline bool operator()(const Term* a, const Term* b) const { return a->L == b->L  ? a->term < b->term : a->L < b->L; }
     };
 
-    class CacheInterface {
+    //term -> cached entry; evicted popular terms stay as zero-length entries,
+    //unless a frequency sketch (TinyLFU) remembers the popularity instead
+    //open addressing with linear probing, so the slot of a future term can be prefetched
+    class LookupTable {
+        struct Slot {
+            term_t term;
+            Term* entry; //nullptr marks an empty slot
+        };
+        typedef IndexUpdate::TrackedVector<Slot, IndexUpdate::CacheTableMemory> Slots;
+        Slots slots;
+        unsigned shift;
+        size_t count;
+        FrequencySketch sketch;
+
+        //entries are recycled, so a table that stopped growing doesn't allocate
+        typedef IndexUpdate::TrackedVector<Term, IndexUpdate::CacheTableMemory> TermChunk;
+        IndexUpdate::TrackedVector<TermChunk, IndexUpdate::CacheTableMemory> termChunks;
+        IndexUpdate::TrackedVector<Term*, IndexUpdate::CacheTableMemory> freeTerms;
+        size_t pooled;
+
+        void growPool(size_t terms) {
+            termChunks.emplace_back(terms);
+            pooled += terms;
+            freeTerms.reserve(pooled); //release() never has to grow it
+            for(auto& t : termChunks.back())
+                freeTerms.push_back(&t);
+        }
+
+        Term* acquire() {
+            if(freeTerms.empty())
+                growPool(std::max<size_t>(1024, count));
+            Term* t = freeTerms.back();
+            freeTerms.pop_back();
+            *t = Term();
+            return t;
+        }
+
+        void release(Term* t) { freeTerms.push_back(t); }
+
+        inline size_t home(term_t term) const { //fibonacci hashing
+            return size_t((uint64_t(term) * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+        inline size_t mask() const { return slots.size()-1; }
+
+        size_t find(term_t term) const {
+            auto i = home(term);
+            while(slots[i].entry && slots[i].term != term)
+                i = (i+1) & mask();
+            return i;
+        }
+
+        void rehash(unsigned newShift) {
+            Slots old(size_t(1) << (64-newShift), Slot{0, nullptr});
+            old.swap(slots);
+            shift = newShift;
+            for(const auto& slot : old)
+                if(slot.entry)
+                    slots[find(slot.term)] = slot;
+        }
+
+        void erase(size_t i) { //backward shift deletion
+            for(auto j = (i+1) & mask(); slots[j].entry; j = (j+1) & mask()) {
+                auto k = home(slots[j].term);
+                bool movable = (j > i) ? (k <= i || k > j) : (k <= i && k > j);
+                if(movable) {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i].entry = nullptr;
+            --count;
+        }
     public:
-        virtual ~CacheInterface() { }
+        LookupTable() : shift(64-10), count(0), pooled(0) {
+            slots.resize(size_t(1) << (64-shift), Slot{0, nullptr});
+        }
+        LookupTable(const LookupTable&) = delete;
+        LookupTable& operator=(const LookupTable&) = delete;
 
-        //length is the up-to-date length of the term on disk (could be smaller if deletes)
-        virtual bool visit(term_t term, size_t length) = 0;
+        //room for that many entries without allocating
+        void reserve(size_t terms) {
+            auto newShift = shift;
+            while(4*terms > 3*(size_t(1) << (64-newShift)))
+                --newShift;
+            if(newShift != shift)
+                rehash(newShift);
+            if(terms > count + freeTerms.size())
+                growPool(terms - count - freeTerms.size());
+        }
+
+        inline Term *lookup(term_t term) const {
+            return slots[find(term)].entry;
+        }
+
+        inline void prefetch(term_t term) const {
+#if defined(__GNUC__)
+            __builtin_prefetch(&slots[home(term)]);
+#endif
+        }
+
+        inline Term* placeNew(term_t term, size_t length) {
+            if(4*(count+1) > 3*slots.size())
+                rehash(shift-1);
+            Term *t = acquire();
+            t->term = term;
+            t->length = length;
+            auto i = find(term);
+            assert(!slots[i].entry);
+            slots[i] = Slot{term, t};
+            ++count;
+            return t;
+        }
+
+        //0 keeps the ghost entries
+        void useFrequencySketch(size_t expectedTerms) { sketch.resize(expectedTerms); }
+        bool admissionEnabled() const { return sketch.enabled(); }
+
+        inline void recordAccess(term_t term) {
+            if(sketch.enabled())
+                sketch.increment(term);
+        }
+
+        //TinyLFU: the candidate replaces the victim only if it is more popular
+        inline bool admits(term_t candidate, term_t victim) const {
+            return !sketch.enabled() || sketch.estimate(candidate) > sketch.estimate(victim);
+        }
+
+        inline void evict(term_t term) {
+            auto i = find(term);
+            assert(slots[i].entry);
+            if(sketch.enabled() || slots[i].entry->hitCount < 3) { //higher values => smaller lookup table, closer to vanilla
+                release(slots[i].entry);
+                erase(i);
+            }
+            else
+                slots[i].entry->length = 0;
+        }
+
+        //every entry, ghosts included, appended to out
+        void entries(std::vector<const Term*>& out) const {
+            out.reserve(out.size() + count);
+            for(const auto& slot : slots)
+                if(slot.entry)
+                    out.push_back(slot.entry);
+        }
+
+        size_t tableSz() const { return count; }
+        size_t bytes() const { return slots.size() * sizeof(Slot) + pooled * sizeof(Term) + sketch.bytes(); }
+        size_t size() const { return std::count_if(slots.begin(),slots.end(),
+                                                   [](const Slot& slot)
+                                                   { return slot.entry && slot.entry->length > 0;}); }
     };
 
-    class BaseCache : public CacheInterface {
+    //the (term, current length) of a single query
+    typedef std::pair<term_t, size_t> TermVisit;
+
+    struct BatchResult {
+        std::vector<bool> hits; //hits[i] is set if the i-th visit of the batch was served by the cache
+        size_t postingsServed;
+        size_t postingsMissed;
+
+        BatchResult() : postingsServed(0), postingsMissed(0) {}
+    };
+
+    //the terms evicted last, up to capacity postings: a miss on one of them would
+    //have been a hit if the cache had that much more room (its marginal utility)
+    class ShadowList {
+        struct Entry {
+            term_t term;
+            size_t length;
+            uint64_t seq;
+        };
+        std::deque<Entry> fifo;
+        std::unordered_map<term_t, uint64_t> live; //term -> seq of its entry
+        size_t capacity;
+        size_t held;
+        uint64_t seq;
+
+        void trim() {
+            while(held > capacity && !fifo.empty()) {
+                const Entry& e = fifo.front();
+                held -= e.length;
+                auto it = live.find(e.term);
+                if(it != live.end() && it->second == e.seq)
+                    live.erase(it);
+                fifo.pop_front();
+            }
+        }
     public:
+        size_t hits;
+        size_t postings;
+
+        ShadowList() : capacity(0), held(0), seq(0), hits(0), postings(0) {}
+
+        bool enabled() const { return capacity; }
+        void setCapacity(size_t maxPostings) {
+            capacity = maxPostings;
+            trim();
+        }
+
+        void add(term_t term, size_t length) {
+            if(!capacity)
+                return;
+            fifo.push_back(Entry{term, length, ++seq});
+            live[term] = seq;
+            held += length;
+            trim();
+        }
+
+        void visit(term_t term, size_t length) {
+            auto it = live.find(term);
+            if(it == live.end())
+                return;
+            ++hits;
+            postings += length;
+            live.erase(it); //back in the cache (or rejected again); its entry just ages out
+        }
+    };
+
+    struct CacheCounters {
         size_t cacheHits;
         size_t cachePostingsServed;
         size_t cachePostingsMissed;
         size_t cacheRejected;
+        size_t cacheNotAdmitted; //lost to a more popular victim (TinyLFU)
+        size_t cacheStaleHits; //found a cached length other than the index's (patched on the hit)
         size_t maxPostings;
 
+        CacheCounters() :
+                cacheHits(0),cachePostingsServed(0),
+                cachePostingsMissed(0),cacheRejected(0),
+                cacheNotAdmitted(0),cacheStaleHits(0),maxPostings(0) {}
+
+        //endLine off: another tier follows on the line
+        //the admission fields (not-admitted, table-bytes) only with a frequency sketch
+        void report(std::ostream& out, const std::string& name, size_t totalP, size_t members, size_t tableSz,
+                    size_t tableBytes, bool admission, unsigned totalQs, bool endLine = true) const;
+    };
+
+    class CacheInterface {
+    public:
+        virtual ~CacheInterface() { }
+
+        //length is the up-to-date length of the term on disk (could be smaller if deletes)
+        virtual bool visit(term_t term, size_t length) = 0;
+
+        //same outcome as visiting [begin,end) one by one, in order
+        virtual void visitBatch(const TermVisit* begin, const TermVisit* end, BatchResult& result) {
+            result.hits.assign(end-begin, false);
+            result.postingsServed = result.postingsMissed = 0;
+            for(auto it = begin; it != end; ++it) {
+                bool isHit = visit(it->first, it->second);
+                result.hits[it-begin] = isHit;
+                (isHit ? result.postingsServed : result.postingsMissed) += it->second;
+            }
+        }
+    };
+
+    //how many visits ahead we prefetch lookup slots
+    const std::ptrdiff_t prefetchDistance = 8;
+
+    class BaseCache : public CacheInterface, public CacheCounters {
+    public:
         BaseCache();
 
         virtual ~BaseCache();
 
         virtual void setMaxPostings(size_t maxP);
 
+        //TinyLFU admission sized for expectedTerms instead of ghost entries (0 restores the ghosts)
+        void useFrequencySketch(size_t expectedTerms);
+
+        //room for that many cached terms without allocating
+        void reserve(size_t terms);
+
         virtual size_t getTotalP() const = 0;
 
         bool visit(unsigned term, size_t length);
 
+        virtual void visitBatch(const TermVisit* begin, const TermVisit* end, BatchResult& result);
+
         size_t size() const; //return the count of cached terms (size of lookup)
 
         virtual std::string name() const = 0;
-        void report(std::ostream& out, unsigned totalQs)const;
+        void report(std::ostream& out, unsigned totalQs, bool endLine = true)const;
     protected:
         virtual void miss(term_t term, size_t length) = 0;
 
         virtual void hit(Term *tptr, size_t length) = 0;
 
+        //a policy may defer its bookkeeping between these two
+        virtual void beginBatch() {}
+        virtual void endBatch() {}
+
         Term *lookup(term_t term) const;
 
         Term *placeNew(term_t term, size_t length);
 
+        void entries(std::vector<const Term*>& out) const;
+
+        bool admits(term_t candidate, term_t victim) const;
+
         //void evictMany(const std::vector<term_t> &victims);
 
         void evict(term_t t);
@@ -81,6 +357,71 @@ namespace  Caching {
 
         BaseCacheIMPL *baseimpl;
     };
+
+    //compile-time counterpart of BaseCache (CRTP): Derived supplies hit/miss/getTotalP/name
+    //and the whole visit path can be inlined into the simulator's query loop
+    template<typename Derived>
+    class StaticCache : public CacheCounters {
+    public:
+        inline bool visit(term_t term, size_t length) {
+            table.recordAccess(term);
+            auto tptr = table.lookup(term);
+            if(tptr && tptr->length) { //hit
+                ++cacheHits;
+                cachePostingsServed += length;
+                derived().hit(tptr, length);
+                return true;
+            }
+            else if(!tptr) { //full miss
+                if(maxPostings <= length)
+                    ++cacheRejected;
+                else
+                    derived().miss(term, length);
+                cachePostingsMissed += length;
+                return false;
+            }
+            //hit of evicted
+            derived().hit(tptr, length);
+            cachePostingsMissed += length;
+            return false;
+        }
+
+        void visitBatch(const TermVisit* begin, const TermVisit* end, BatchResult& result) {
+            result.hits.assign(end-begin, false);
+            const auto served = cachePostingsServed;
+            const auto missed = cachePostingsMissed;
+            derived().beginBatch();
+            for(auto it = begin; it != end; ++it) {
+                if(end - it > prefetchDistance)
+                    table.prefetch(it[prefetchDistance].first);
+                result.hits[it-begin] = visit(it->first, it->second);
+            }
+            derived().endBatch();
+            result.postingsServed = cachePostingsServed - served;
+            result.postingsMissed = cachePostingsMissed - missed;
+        }
+
+        size_t size() const { return table.size(); }
+
+        void useFrequencySketch(size_t expectedTerms) { table.useFrequencySketch(expectedTerms); }
+
+        void reserve(size_t terms) { table.reserve(terms); }
+
+        void report(std::ostream& out, unsigned totalQs, bool endLine = true) const {
+            const Derived& self = static_cast<const Derived&>(*this);
+            CacheCounters::report(out, self.name(), self.getTotalP(), size(), table.tableSz(), table.bytes(),
+                                  table.admissionEnabled(), totalQs, endLine);
+        }
+    protected:
+        Term *lookup(term_t term) const { return table.lookup(term); }
+        Term *placeNew(term_t term, size_t length) { return table.placeNew(term, length); }
+        void entries(std::vector<const Term*>& out) const { table.entries(out); }
+        bool admits(term_t candidate, term_t victim) const { return table.admits(candidate, victim); }
+        void evict(term_t t) { table.evict(t); }
+    private:
+        inline Derived& derived() { return static_cast<Derived&>(*this); }
+        LookupTable table;
+    };
 }
 
 #endif //CACHING_CACHING_H
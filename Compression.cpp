@@ -0,0 +1,73 @@
+#include "Compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace IndexUpdate {
+
+    namespace {
+        //bits of a gap of that size
+        double gapBits(double gap) { return std::floor(std::log2(std::max(gap, 1.0))) + 1; }
+
+        //a docid gap and a frequency of a posting, in bytes
+        double codecBytes(Codec codec, double gap) {
+            if(VarByte == codec) //7 bits a byte, a frequency is (almost always) one byte
+                return std::ceil(gapBits(gap) / 7) + 1;
+            //bit packed blocks (PForDelta like): the gap width plus an exception bit, 2 bits of frequency
+            return (gapBits(gap) + 1 + 2) / 8;
+        }
+    }
+
+    CompressionModel::CompressionModel() : wordBytes(4), allGapBytes(4), allMembers(0) {}
+
+    void CompressionModel::init(const Settings& settings) {
+        config = settings.compression;
+        wordBytes = settings.szOfPostingBytes;
+        gapBytes.clear();
+        members.clear();
+        allGapBytes = wordBytes;
+        allMembers = 0;
+        if(!enabled())
+            return;
+        //the CPU costs of the codec, unless configured
+        if(config.decodeNsPerPosting <= 0)
+            config.decodeNsPerPosting = VarByte == config.codec ? 2.0 : 1.0;
+        if(config.encodeNsPerPosting <= 0)
+            config.encodeNsPerPosting = VarByte == config.codec ? 3.0 : 6.0;
+
+        const double updates = std::accumulate(settings.tpUpdates.begin(), settings.tpUpdates.end(), 0.0);
+        double bytes = 0;
+        for(size_t i = 0; i < settings.tpUpdates.size(); ++i) {
+            const double share = double(settings.tpUpdates[i]) / updates;
+            const double gap = double(settings.tpMembers[i]) / (share * config.termsPerDoc);
+            gapBytes.push_back(codecBytes(config.codec, gap));
+            members.push_back(settings.tpMembers[i]);
+            bytes += share * gapBytes.back();
+            allMembers += settings.tpMembers[i];
+        }
+        allGapBytes = bytes;
+    }
+
+    uint64_t CompressionModel::storedWords(int packId, uint64_t postings, uint64_t lists) const {
+        if(!postings)
+            return 0;
+        const double bytes = double(postings) * postingBytes(packId) + double(lists) * config.listOverheadBytes;
+        return uint64_t(std::ceil(bytes / wordBytes));
+    }
+
+    ConsolidationStats CompressionModel::storedMerge(int packId, const ConsolidationStats& cost,
+                                                     uint64_t segments) const {
+        //a list holds at least one posting
+        const uint64_t readLists = std::min<uint64_t>(cost.reads.postings, packMembers(packId) * segments);
+        const uint64_t writeLists = std::min<uint64_t>(cost.writes.postings, packMembers(packId));
+        return ConsolidationStats(ReadIO(storedWords(packId, cost.reads.postings, readLists), cost.reads.seeks),
+                                  WriteIO(storedWords(packId, cost.writes.postings, writeLists), cost.writes.seeks));
+    }
+
+    void CompressionModel::report(std::ostream& out) const {
+        out << " Compression: codec: " << (VarByte == config.codec ? "varbyte" : "bitpacked") <<
+            " bytes-per-posting: " << allGapBytes <<
+            " decode-ns: " << config.decodeNsPerPosting << " encode-ns: " << config.encodeNsPerPosting;
+    }
+}
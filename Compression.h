@@ -0,0 +1,55 @@
+#ifndef UPDATE_LITE_COMPRESSION_H
+#define UPDATE_LITE_COMPRESSION_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "Settings.h"
+#include "Consolidation.h"
+
+namespace IndexUpdate {
+
+    //the stored size of the postings under Settings::compression. The postings of a pack are
+    //spread evenly over its members and over the documents, so a list's mean docid gap is
+    //members / (share of the postings * terms per doc) whatever the segment (merging only
+    //concatenates docid ranges); the codec packs a gap and a frequency into so many bytes.
+    //Each list of a segment also has a header (and skips) of listOverheadBytes, so short
+    //lists of fresh segments cost more per posting than the merged ones.
+    //The I/O of the simulator is then counted in szOfPostingBytes words of stored data
+    class CompressionModel {
+        Compression config;
+        unsigned wordBytes;
+        std::vector<double> gapBytes; //per pack
+        std::vector<uint64_t> members;
+        double allGapBytes; //of the postings of all the packs (a monolithic segment)
+        uint64_t allMembers;
+    public:
+        CompressionModel();
+
+        void init(const Settings& settings);
+        bool enabled() const { return config.codec != Uncompressed; }
+
+        //bytes of a posting of the pack (without the list headers)
+        double postingBytes(int packId) const { return packId < 0 ? allGapBytes : gapBytes[size_t(packId)]; }
+
+        //postings of packId (-1: of all the packs) in that many lists, as stored words
+        uint64_t storedWords(int packId, uint64_t postings, uint64_t lists) const;
+        uint64_t packMembers(int packId) const { return packId < 0 ? allMembers : members[size_t(packId)]; }
+
+        //a query reads one list a segment (a seek)
+        ReadIO storedQuery(int packId, ReadIO io) const {
+            return ReadIO(storedWords(packId, io.postings, io.seeks), io.seeks);
+        }
+        //a merge of that many segments (1: a flush) reads all their lists and writes those of one
+        ConsolidationStats storedMerge(int packId, const ConsolidationStats& cost, uint64_t segments) const;
+
+        //CPU minutes to decode / encode that many postings
+        double decodeMinutes(uint64_t postings) const { return double(postings) * config.decodeNsPerPosting / 6e10; }
+        double encodeMinutes(uint64_t postings) const { return double(postings) * config.encodeNsPerPosting / 6e10; }
+
+        void report(std::ostream& out) const;
+    };
+}
+
+#endif //UPDATE_LITE_COMPRESSION_H
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <numeric>
 #include "Consolidation.h"
 
 namespace IndexUpdate {
@@ -8,8 +9,9 @@ namespace IndexUpdate {
     }
 
     class KWaySegmentConsolidator {
-        std::vector<size_t> &segHeap;
+        SegmentScratch &segHeap;
         const size_t memSizeInPostings;
+        const bool interleaved;
         size_t lastSize;
         ConsolidationStats cost;
 
@@ -20,11 +22,11 @@ namespace IndexUpdate {
 
             size_t reads = smallest1 + smallest2;
             size_t writes = reads;
-            unsigned totalReadSeeks = 2;
+            size_t totalReadSeeks = readSeeks(smallest1) + readSeeks(smallest2);
 
             //if one of the smallest is in mem
             if (lastSize && (lastSize == smallest1 || lastSize == smallest2)) {
-                --totalReadSeeks;
+                totalReadSeeks -= readSeeks(lastSize);
                 reads -= lastSize;
                 lastSize = 0;
             }
@@ -49,14 +51,14 @@ namespace IndexUpdate {
                         break;
                     }
                     reads += seg;
-                    ++totalReadSeeks;
+                    totalReadSeeks += readSeeks(seg);
                 }
                 writes += seg;
             }
 
             push(writes);
             //S,R,W
-            cost += ConsolidationStats(reads, totalReadSeeks, writes, 1);
+            cost += ConsolidationStats(reads, totalReadSeeks, writes, interleaved ? _rfdiv(writes, writePShare()) : 1);
             return true;
         }
 
@@ -73,6 +75,9 @@ namespace IndexUpdate {
         }
 
         inline size_t writePShare() const { return (memSizeInPostings / 2); }
+        //a segment read whole into memory seeks once, unless other merges interleave with it:
+        //then it is read a quarter of the memory at a time, as in round2Way
+        inline size_t readSeeks(size_t seg) const { return interleaved ? _rfdiv(seg, writePShare() / 2) : 1; }
 
         void round2Way() {
             const auto writeShare = writePShare();
@@ -101,9 +106,9 @@ namespace IndexUpdate {
 
     public:
 
-        KWaySegmentConsolidator(std::vector<size_t> &segments,
-                                size_t lastInMem = 1 /*0 or 1*/, size_t memBufferPostings = 1ULL<<26)
-                : segHeap(segments), memSizeInPostings(memBufferPostings) {
+        KWaySegmentConsolidator(SegmentScratch &segments, const MergeModel& model,
+                                size_t lastInMem = 1 /*0 or 1*/)
+                : segHeap(segments), memSizeInPostings(model.memoryPostings), interleaved(model.interleaved) {
 
             assert(lastInMem < 2);
             lastSize = segHeap.back() * lastInMem;
@@ -122,15 +127,8 @@ namespace IndexUpdate {
         }
     };
 
-    ConsolidationStats consolidateSegments(std::vector<uint64_t>& segments, unsigned offset) {
-        assert(segments.size()>1);
-        std::vector<uint64_t> consolidants(segments.begin() + offset, segments.end());
-
-        auto writtenPostings = std::accumulate(segments.begin()+offset,segments.end(),0ull);
-        segments.erase(segments.begin()+offset,segments.end());
-        segments.push_back(writtenPostings);
-
-        return KWaySegmentConsolidator(consolidants)();
+    ConsolidationStats mergeCost(SegmentScratch& consolidants, const MergeModel& model) {
+        return KWaySegmentConsolidator(consolidants, model)();
     }
 
 }
\ No newline at end of file
@@ -4,8 +4,11 @@
 #include <cstdint>
 #include <ostream>
 #include <vector>
+#include <numeric>
 #include <cassert>
 
+#include "MemoryAccounting.h"
+
 namespace IndexUpdate {
 
     template<bool RorW>
@@ -28,6 +31,12 @@ namespace IndexUpdate {
         return a;
     }
 
+    //a - b, for b accumulated before a
+    template<bool RorW>
+    inline DiskIOCost<RorW> operator-(DiskIOCost<RorW> a, DiskIOCost<RorW> b) {
+        return DiskIOCost<RorW>(a.postings - b.postings, a.seeks - b.seeks);
+    }
+
     template<bool RorW>
     std::ostream& operator<<(std::ostream& out, DiskIOCost<RorW> io) {
         char t = RorW ? 'w' : 'r';
@@ -42,9 +51,26 @@ namespace IndexUpdate {
         return double(ms)/60000.0; //convert to minutes
     }
 
+    //same model as costIoInMinutes, without rounding to whole ms (for latencies of single requests)
+    template<typename IO >
+    double ioLatencyMs(IO io, uint64_t ioMBS, double ioSeeks, unsigned postingSzBytes) {
+        const double bytesPerMs = double(ioMBS<<20)/1000.0;
+        return ioSeeks * io.seeks + double(io.postings * postingSzBytes)/bytesPerMs;
+    }
+
     typedef DiskIOCost<false> ReadIO;
     typedef DiskIOCost<true> WriteIO;
 
+    //the memory of a merge, and how its I/O meets that of the merges running with it
+    struct MergeModel {
+        uint64_t memoryPostings; //half buffers the output, the rest the inputs
+        //the merges running at once share one head (HD): each refill of an input buffer and each
+        //flush of the output buffer seeks, as the head moved away since the last one
+        bool interleaved;
+        explicit MergeModel(uint64_t memory = 1ULL<<26, bool inter = false) :
+                memoryPostings(memory), interleaved(inter) {}
+    };
+
     class ConsolidationStats {
     public:
         ReadIO reads;
@@ -61,6 +87,9 @@ namespace IndexUpdate {
             writes += w;
             return *this;
         }
+        ConsolidationStats operator-(const ConsolidationStats& rhs) const {
+            return ConsolidationStats(reads - rhs.reads, writes - rhs.writes);
+        }
 
         static double costInMinutes(const ConsolidationStats& stats,
                                     uint64_t ioMBS, double ioSeeks, unsigned postingSzBytes) {
@@ -80,8 +109,12 @@ namespace IndexUpdate {
     //if last two are not comparable, returns size-1
     //return of size-1 usually means -- write down the last one!
     //if every suffix is comparable to the one before suffix, will return 0
-    template<typename T>
-    unsigned offsetOfTelescopicMerge(const std::vector<T>& sizeStack) {
+    //the segment sizes of a pack (or of the monolithic index), oldest first
+    typedef TrackedVector<uint64_t, SegmentMemory> SegmentStack;
+    typedef TrackedVector<uint64_t, ScratchMemory> SegmentScratch;
+
+    template<typename Stack>
+    unsigned offsetOfTelescopicMerge(const Stack& sizeStack) {
         //TODO: use reverse iterator?
         assert(sizeStack.size());
         auto i = sizeStack.size()-1; //point to last
@@ -94,7 +127,21 @@ namespace IndexUpdate {
         return 0;
     }
 
-    ConsolidationStats consolidateSegments(std::vector<uint64_t>& segments, unsigned offset);
+    //the cost of merging the consolidants into one segment (they are used up)
+    ConsolidationStats mergeCost(SegmentScratch& consolidants, const MergeModel& model = MergeModel());
+
+    //replaces the segments from offset on with their merge
+    template<typename Stack>
+    ConsolidationStats consolidateSegments(Stack& segments, unsigned offset, const MergeModel& model = MergeModel()) {
+        assert(segments.size()>1);
+        SegmentScratch consolidants(segments.begin() + offset, segments.end());
+
+        auto writtenPostings = std::accumulate(segments.begin()+offset,segments.end(),0ull);
+        segments.erase(segments.begin()+offset,segments.end());
+        segments.push_back(writtenPostings);
+
+        return mergeCost(consolidants, model);
+    }
 
     inline std::ostream& operator<<(std::ostream& out, const ConsolidationStats& io) {
         return out << io.reads << ' ' << io.writes;
@@ -102,9 +149,9 @@ namespace IndexUpdate {
 
     //this one doesn't work with <2 segments!
     template<typename IT>
-    ConsolidationStats kWayConsolidate(IT begin, IT end) {
-        std::vector<uint64_t > segments(begin,end);
-        return consolidateSegments(segments, 0);
+    ConsolidationStats kWayConsolidate(IT begin, IT end, const MergeModel& model = MergeModel()) {
+        SegmentScratch segments(begin,end);
+        return mergeCost(segments, model);
     }
 }
 
@@ -0,0 +1,84 @@
+#include "Forecaster.h"
+#include "SkiRental.h"
+
+#include <numeric>
+#include <limits>
+#include <algorithm>
+
+namespace IndexUpdate {
+
+    Forecaster::Forecaster() :
+            ingestedSeen(0), ioMBS(0), ioSeek(0), postingBytes(0), maxHorizon(0) {}
+
+    void Forecaster::init(const Settings& settings, const std::vector<TermPack>& tpacks) {
+        prognosis = settings.prognosis;
+        ioMBS = settings.ioMBS;
+        ioSeek = settings.ioSeek;
+        postingBytes = settings.szOfPostingBytes;
+        merging = mergeModel(settings);
+        maxHorizon = uint64_t(prognosis.maxHorizonBuffers * double(settings.updateBufferPostingsLimit));
+        ingestedSeen = 0;
+
+        const double totalQueries = std::accumulate(settings.tpQueries.begin(), settings.tpQueries.end(), 0.0);
+        const double totalUpdates = std::accumulate(settings.tpUpdates.begin(), settings.tpUpdates.end(), 0.0);
+        const double queriesPerPosting = double(settings.quieriesQuant) / double(settings.updatesQuant);
+        forecasts.clear();
+        for(const auto& tp : tpacks)
+            forecasts.push_back(Forecast{
+                    double(settings.tpQueries[tp.id()]) / totalQueries * queriesPerPosting,
+                    double(settings.tpUpdates[tp.id()]) / totalUpdates,
+                    tp.diskQueries(), tp.receivedPostings()});
+    }
+
+    void Forecaster::observe(const std::vector<TermPack>& tpacks, uint64_t ingested) {
+        if(ingested <= ingestedSeen)
+            return;
+        const double span = double(ingested - ingestedSeen);
+        const double a = prognosis.smoothing;
+        for(const auto& tp : tpacks) {
+            auto& f = forecasts[tp.id()];
+            f.queries = a * double(tp.diskQueries() - f.queriesSeen) / span + (1 - a) * f.queries;
+            f.updates = a * double(tp.receivedPostings() - f.postingsSeen) / span + (1 - a) * f.updates;
+            f.queriesSeen = tp.diskQueries();
+            f.postingsSeen = tp.receivedPostings();
+        }
+        ingestedSeen = ingested;
+    }
+
+    Forecaster::Plan Forecaster::plan(const TermPack& tp) {
+        const auto& f = forecasts[tp.id()];
+        const uint64_t buffered = tp.bufferedPostings() + tp.bufferedTombstones(); //about what the flush writes
+        assert(buffered);
+        //the layout chosen now lasts until the pack's buffer holds as much again
+        const double horizon = f.updates > 0 ?
+                               std::min(double(maxHorizon), double(buffered) / f.updates) : double(maxHorizon);
+        const double seekMinutes = f.queries * horizon * ioSeek / 60000.0; //per segment over the horizon
+
+        scratch.assign(tp.segments().begin(), tp.segments().end());
+        scratch.push_back(buffered);
+        const unsigned last = unsigned(scratch.size()) - 1;
+
+        //just the write of the new segment
+        Plan best{tp.id(), last, ConsolidationStats::costInMinutes(ConsolidationStats(0, 0, buffered, 0),
+                                                                   ioMBS, ioSeek, postingBytes) +
+                                 seekMinutes * double(scratch.size())};
+        for(int offset = int(last) - 1; offset >= 0; --offset) {
+            const double merge = ConsolidationStats::costInMinutes(
+                    kWayConsolidate(scratch.begin() + offset, scratch.end(), merging), ioMBS, ioSeek, postingBytes);
+            if(merge >= best.extraMinutes)
+                break; //deeper only costs more
+            const double total = merge + seekMinutes * double(offset + 1);
+            if(total < best.extraMinutes) {
+                best.offset = unsigned(offset);
+                best.extraMinutes = total;
+            }
+        }
+        //not flushing: the queries keep paying for the current segments, and read the buffered postings from memory
+        const double bytesPerMs = double(uint64_t(ioMBS) << 20) / 1000.0;
+        const double readMinutes = f.queries * horizon *
+                                   double(buffered / tp.members() * postingBytes) / bytesPerMs / 60000.0;
+        best.extraMinutes = (best.extraMinutes + readMinutes - seekMinutes * double(tp.segments().size())) /
+                            double(buffered);
+        return best;
+    }
+}
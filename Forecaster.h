@@ -0,0 +1,59 @@
+#ifndef UPDATE_LITE_FORECASTER_H
+#define UPDATE_LITE_FORECASTER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Settings.h"
+#include "TermPack.h"
+
+namespace IndexUpdate {
+
+    //the Prognosticator algorithm, a forecasting eviction policy: every pack's query and update rates (per ingested posting) are
+    //exponentially weighted averages of what it saw between evictions, seeded by tpQueries/tpUpdates.
+    //A pack flushed now keeps its segment layout until its buffer fills up again, so over that horizon
+    //its queries pay a seek per segment and read from disk what the buffer served; the flush picks the
+    //consolidation depth with the least merge-plus-seek minutes, and the packs are flushed by the least
+    //extra minutes per freed posting.
+    //On SSD (training profile) a seek is 0.0625 ms: over the horizon the seeks of one more segment pay for
+    //no merge, so like the ski rental it only writes new segments, and since the least queried packs have
+    //the larger IDs the cheapest room is flushed in the ski rental's order too, with the same results
+    class Forecaster {
+        struct Forecast {
+            double queries; //disk queries per ingested posting
+            double updates; //share of the ingested postings
+            uint64_t queriesSeen;
+            uint64_t postingsSeen;
+        };
+        std::vector<Forecast> forecasts;
+        uint64_t ingestedSeen;
+        Prognosis prognosis;
+        unsigned ioMBS;
+        double ioSeek;
+        unsigned postingBytes;
+        uint64_t maxHorizon;
+        MergeModel merging; //of settings.mergeMemory
+        SegmentScratch scratch;
+    public:
+        struct Plan {
+            unsigned pack;
+            unsigned offset; //as in consolidateTP, counted with the flushed segment
+            double extraMinutes; //over not flushing, per freed posting
+        };
+
+        Forecaster();
+
+        void init(const Settings& settings, const std::vector<TermPack>& tpacks);
+
+        //folds in the history since the previous call
+        void observe(const std::vector<TermPack>& tpacks, uint64_t ingested);
+
+        //the best flush of tp now (its buffer must not be empty)
+        Plan plan(const TermPack& tp);
+
+        double queryRate(unsigned pack) const { return forecasts[pack].queries; }
+        double updateRate(unsigned pack) const { return forecasts[pack].updates; }
+    };
+}
+
+#endif //UPDATE_LITE_FORECASTER_H
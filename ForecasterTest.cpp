@@ -0,0 +1,69 @@
+#include <iostream>
+
+#include "Forecaster.h"
+#include "Profiles.h"
+
+using namespace IndexUpdate;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if(!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+//the last pack on SSD, two segments on disk and as much again buffered: the offset of its plan
+//follows the query rate the forecaster observed
+static void followsQueryRate() {
+    Settings settings = Profiles::training(SSD);
+    settings.updateBufferPostingsLimit = 1 << 22;
+
+    std::vector<TermPack> tpacks;
+    for(unsigned i = 0; i < settings.tpMembers.size(); ++i)
+        tpacks.emplace_back(TermPack(i, settings.tpMembers[i]));
+    TermPack& tp = tpacks.back();
+    Forecaster forecaster;
+    forecaster.init(settings, tpacks);
+
+    //the rest of the updates go to the first pack
+    uint64_t ingested = 0;
+    auto ingest = [&](TermPack& to, uint64_t postings) {
+        to.addUBPostings(postings);
+        ingested += postings;
+    };
+    for(unsigned i = 0; i < 3; ++i) {
+        ingest(tp, 1 << 16);
+        if(i < 2)
+            tp.flush();
+    }
+
+    //no queries: the seeks of one more segment cost less than any merge
+    for(unsigned round = 0; round < 30; ++round) {
+        ingest(tpacks.front(), 1 << 20);
+        forecaster.observe(tpacks, ingested);
+    }
+    const auto quiet = forecaster.plan(tp);
+    check(forecaster.queryRate(tp.id()) < 1e-6, "the quiet pack's query rate decays");
+    check(quiet.offset == tp.segments().size(), "a quiet pack just writes the new segment");
+
+    //a query every 64 postings ingested: the seeks pay for consolidating all three segments
+    for(unsigned round = 0; round < 30; ++round) {
+        for(unsigned q = 0; q < (1 << 14); ++q)
+            tp.query();
+        ingest(tpacks.front(), 1 << 20);
+        forecaster.observe(tpacks, ingested);
+    }
+    const auto busy = forecaster.plan(tp);
+    check(busy.offset < quiet.offset, "the busy pack consolidates deeper");
+    check(busy.offset == 0, "a busy pack consolidates all its segments");
+    check(forecaster.queryRate(tp.id()) > 0.9 / 64, "the busy pack's query rate converges");
+}
+
+int main() {
+    followsQueryRate();
+    if(!failures)
+        std::cout << "Forecaster: all passed" << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,41 @@
+#include "FrequencySketch.h"
+
+namespace Caching {
+
+    void FrequencySketch::resize(size_t expectedItems) {
+        table.clear();
+        additions = 0;
+        if(!expectedItems)
+            return;
+        size_t width = 64;
+        shift = 64-6;
+        while(width < expectedItems) {
+            width <<= 1;
+            --shift;
+        }
+        rowWords = width >> 4;
+        table.assign(depth * rowWords, 0);
+        sampleSize = 10 * width;
+    }
+
+    void FrequencySketch::increment(uint64_t item) {
+        bool added = false;
+        for(unsigned r = 0; r < depth; ++r) {
+            auto i = index(item, r);
+            auto& word = table[r*rowWords + (i >> 4)];
+            auto offset = (i & 15) << 2;
+            if(((word >> offset) & 0xF) != 0xF) {
+                word += uint64_t(1) << offset;
+                added = true;
+            }
+        }
+        if(added && ++additions == sampleSize)
+            reset();
+    }
+
+    void FrequencySketch::reset() { //aging: halve every counter
+        for(auto& word : table)
+            word = (word >> 1) & 0x7777777777777777ull;
+        additions /= 2;
+    }
+}
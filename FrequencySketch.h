@@ -0,0 +1,56 @@
+#ifndef CACHING_FREQUENCYSKETCH_H
+#define CACHING_FREQUENCYSKETCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "MemoryAccounting.h"
+
+namespace Caching {
+    //count-min sketch of 4-bit counters with periodic aging (TinyLFU):
+    //after sampleSize increments all the counters are halved
+    class FrequencySketch {
+        static const unsigned depth = 4;
+        IndexUpdate::TrackedVector<uint64_t, IndexUpdate::CacheTableMemory> table; //depth rows of 16 counters per word
+        size_t rowWords;
+        unsigned shift;
+        size_t sampleSize;
+        size_t additions;
+
+        inline size_t index(uint64_t item, unsigned row) const {
+            static const uint64_t seeds[depth] = {
+                    0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full,
+                    0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull};
+            return size_t(((item+1) * seeds[row]) >> shift);
+        }
+
+        inline unsigned counter(size_t row, size_t i) const {
+            return unsigned(table[row*rowWords + (i >> 4)] >> ((i & 15) << 2)) & 0xF;
+        }
+
+        void reset();
+    public:
+        FrequencySketch() : rowWords(0), shift(64), sampleSize(0), additions(0) {}
+
+        //expectedItems drives the width; 0 disables the sketch
+        void resize(size_t expectedItems);
+
+        bool enabled() const { return !table.empty(); }
+
+        void increment(uint64_t item);
+
+        unsigned estimate(uint64_t item) const {
+            unsigned freq = 0xF;
+            for(unsigned r = 0; r < depth; ++r) {
+                auto c = counter(r, index(item, r));
+                freq = c < freq ? c : freq;
+            }
+            return freq;
+        }
+
+        size_t bytes() const { return table.size() * sizeof(uint64_t); }
+    };
+}
+
+#endif //CACHING_FREQUENCYSKETCH_H
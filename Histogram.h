@@ -0,0 +1,84 @@
+#ifndef UPDATE_LITE_HISTOGRAM_H
+#define UPDATE_LITE_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace IndexUpdate {
+
+    //log-linear buckets (HDR style): values below 2^subBits are exact,
+    //larger ones are kept within a relative error of 2^-subBits
+    class Histogram {
+        static const unsigned subBits = 7;
+        std::vector<uint64_t> counts;
+        uint64_t total;
+        uint64_t maxValue;
+
+        static unsigned msb(uint64_t v) {
+#if defined(__GNUC__)
+            return 63 - __builtin_clzll(v);
+#else
+            unsigned r = 0;
+            while(v >>= 1)
+                ++r;
+            return r;
+#endif
+        }
+
+        static size_t bucketOf(uint64_t v) {
+            if(v < (uint64_t(1) << subBits))
+                return size_t(v);
+            unsigned shift = msb(v) - subBits;
+            return (size_t(shift+1) << subBits) + size_t((v >> shift) - (uint64_t(1) << subBits));
+        }
+
+        //the largest value that falls into bucket b
+        static uint64_t highestOf(size_t b) {
+            if(b < (size_t(1) << subBits))
+                return b;
+            unsigned shift = unsigned(b >> subBits) - 1;
+            uint64_t sub = (b & ((size_t(1) << subBits) - 1)) + (uint64_t(1) << subBits);
+            return ((sub + 1) << shift) - 1;
+        }
+    public:
+        Histogram() : total(0), maxValue(0) {}
+
+        inline void record(uint64_t v) {
+            auto b = bucketOf(v);
+            if(b >= counts.size())
+                counts.resize(b+1, 0);
+            ++counts[b];
+            ++total;
+            maxValue = v > maxValue ? v : maxValue;
+        }
+
+        //adds the values other recorded (of another run, worker or shard)
+        void merge(const Histogram& other) {
+            if(other.counts.size() > counts.size())
+                counts.resize(other.counts.size(), 0);
+            for(size_t b = 0; b < other.counts.size(); ++b)
+                counts[b] += other.counts[b];
+            total += other.total;
+            maxValue = other.maxValue > maxValue ? other.maxValue : maxValue;
+        }
+
+        uint64_t count() const { return total; }
+        uint64_t max() const { return maxValue; }
+
+        //q in [0,1]
+        uint64_t percentile(double q) const {
+            if(!total)
+                return 0;
+            uint64_t rank = uint64_t(q * double(total));
+            rank = rank < 1 ? 1 : (rank > total ? total : rank);
+            uint64_t seen = 0;
+            for(size_t b = 0; b < counts.size(); ++b)
+                if((seen += counts[b]) >= rank)
+                    return highestOf(b) < maxValue ? highestOf(b) : maxValue;
+            return maxValue;
+        }
+    };
+}
+
+#endif //UPDATE_LITE_HISTOGRAM_H
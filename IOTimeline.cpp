@@ -0,0 +1,105 @@
+#include "IOTimeline.h"
+
+#include <algorithm>
+
+namespace IndexUpdate {
+
+    IOTimeline::IOTimeline() :
+            postingBytes(0), readBytesPerMs(0), writeBytesPerMs(0),
+            busyMs(0), backgroundBusyMs(0), lastFinish(0),
+            queries(0), queryLatencyMs(0), queryWaitMs(0), maxQueryLatencyMs(0) {}
+
+    void IOTimeline::init(const DeviceModel& device, unsigned szOfPostingBytes) {
+        model = device;
+        postingBytes = szOfPostingBytes;
+        freeAt.clear();
+        background.clear();
+        busyMs = backgroundBusyMs = lastFinish = 0;
+        queries = 0;
+        queryLatencyMs = queryWaitMs = maxQueryLatencyMs = 0;
+        if(!model.timeline)
+            return;
+        readBytesPerMs = double(uint64_t(model.readMBS) << 20) / 1000.0 / model.channels;
+        writeBytesPerMs = double(uint64_t(model.writeMBS) << 20) / 1000.0 / model.channels;
+        freeAt.assign(std::max(1u, std::min(model.channels, model.queueDepth)), 0.0);
+    }
+
+    //calls f(bytes, first) for every request of extents extents sharing postings
+    template<typename F>
+    void IOTimeline::splitExtents(uint64_t postings, uint64_t extents, F f) const {
+        if(!postings && !extents)
+            return;
+        extents = std::max<uint64_t>(extents, 1);
+        const uint64_t totalBytes = postings * postingBytes;
+        for(uint64_t e = 0; e < extents; ++e) {
+            uint64_t bytes = totalBytes / extents + (e < totalBytes % extents ? 1 : 0);
+            bool first = true;
+            do {
+                auto req = std::min(bytes, model.maxRequestBytes);
+                f(req, first);
+                bytes -= req;
+                first = false;
+            } while(bytes);
+        }
+    }
+
+    void IOTimeline::dispatchBefore(double t) {
+        while(!background.empty()) {
+            auto c = earliest();
+            const Request& r = background.front();
+            auto start = std::max(freeAt[c], r.ready);
+            if(start >= t)
+                break;
+            freeAt[c] = start + r.service;
+            lastFinish = std::max(lastFinish, freeAt[c]);
+            busyMs += r.service;
+            backgroundBusyMs += r.service;
+            background.pop_front();
+        }
+    }
+
+    double IOTimeline::query(double arrivalMs, ReadIO io) {
+        dispatchBefore(arrivalMs);
+        ++queries;
+        double done = arrivalMs;
+        splitExtents(io.postings, io.seeks, [&](uint64_t bytes, bool first) {
+            auto c = earliest();
+            auto start = std::max(arrivalMs, freeAt[c]);
+            auto s = service(bytes, false, first);
+            queryWaitMs += start - arrivalMs;
+            freeAt[c] = start + s;
+            busyMs += s;
+            done = std::max(done, freeAt[c]);
+        });
+        lastFinish = std::max(lastFinish, done);
+        auto latency = done - arrivalMs;
+        queryLatencyMs += latency;
+        maxQueryLatencyMs = std::max(maxQueryLatencyMs, latency);
+        return latency;
+    }
+
+    void IOTimeline::merge(double submitMs, const ConsolidationStats& stats, double bytesPerMs) {
+        double sent = 0;
+        auto ready = [&](uint64_t bytes) {
+            auto t = bytesPerMs > 0 ? submitMs + sent / bytesPerMs : submitMs;
+            sent += double(bytes);
+            return t;
+        };
+        splitExtents(stats.reads.postings, stats.reads.seeks, [&](uint64_t bytes, bool first) {
+            background.push_back(Request{ready(bytes), service(bytes, false, first)});
+        });
+        splitExtents(stats.writes.postings, stats.writes.seeks, [&](uint64_t bytes, bool first) {
+            background.push_back(Request{ready(bytes), service(bytes, true, first)});
+        });
+    }
+
+    void IOTimeline::report(std::ostream& out) const {
+        const double span = lastFinish * freeAt.size();
+        out << " Device: channels: " << model.channels << " qd: " << model.queueDepth
+            << " query-latency-mean-ms: " << (queries ? queryLatencyMs / double(queries) : 0.0)
+            << " query-latency-max-ms: " << maxQueryLatencyMs
+            << " query-wait-minutes: " << queryWaitMs / 60000.0
+            << " merge-device-minutes: " << backgroundBusyMs / model.channels / 60000.0 //each channel has its share of the bandwidth
+            << " utilization-pct: " << (span > 0 ? busyMs / span * 100.0 : 0.0);
+    }
+}
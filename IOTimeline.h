@@ -0,0 +1,81 @@
+#ifndef UPDATE_LITE_IOTIMELINE_H
+#define UPDATE_LITE_IOTIMELINE_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <ostream>
+
+#include "Settings.h"
+#include "Consolidation.h"
+
+namespace IndexUpdate {
+
+    //simulated I/O timeline of a DeviceModel: every request occupies one of min(channels, queueDepth)
+    //servers. Background (merge) requests are queued and dispatched lazily in time order, so the
+    //foreground (query) requests interleave with them request by request and wait only for
+    //what is already in flight.
+    class IOTimeline {
+        DeviceModel model;
+        unsigned postingBytes;
+        double readBytesPerMs; //per channel
+        double writeBytesPerMs;
+        std::vector<double> freeAt; //ms, per server
+
+        struct Request {
+            double ready;
+            double service;
+        };
+        std::deque<Request> background;
+
+        double busyMs;
+        double backgroundBusyMs;
+        double lastFinish;
+        uint64_t queries;
+        double queryLatencyMs;
+        double queryWaitMs;
+        double maxQueryLatencyMs;
+
+        double service(uint64_t bytes, bool write, bool withLatency) const {
+            return (withLatency ? (write ? model.writeLatency : model.readLatency) : 0.0) +
+                   double(bytes) / (write ? writeBytesPerMs : readBytesPerMs);
+        }
+
+        size_t earliest() const {
+            size_t best = 0;
+            for(size_t i = 1; i < freeAt.size(); ++i)
+                if(freeAt[i] < freeAt[best])
+                    best = i;
+            return best;
+        }
+
+        //dispatches the background requests that start before t
+        void dispatchBefore(double t);
+
+        template<typename F>
+        void splitExtents(uint64_t postings, uint64_t extents, F f) const;
+    public:
+        IOTimeline();
+
+        void init(const DeviceModel& device, unsigned szOfPostingBytes);
+        bool enabled() const { return !freeAt.empty(); }
+
+        static double postingsToMs(uint64_t postings, const DeviceModel& device) {
+            return double(postings) / device.ingestPostingsPerSec * 1000.0;
+        }
+
+        //reads one extent per seek, all issued at arrival; returns the latency in ms
+        double query(double arrivalMs, ReadIO io);
+
+        //queued behind the earlier background requests; a positive bytesPerMs paces
+        //the requests so that the merge does not take more of the bandwidth
+        void merge(double submitMs, const ConsolidationStats& stats, double bytesPerMs = 0);
+
+        //dispatches all the queued background work
+        void drain() { dispatchBefore(1e300); }
+
+        void report(std::ostream& out) const;
+    };
+}
+
+#endif //UPDATE_LITE_IOTIMELINE_H
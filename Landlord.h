@@ -2,24 +2,344 @@
 #define CACHING_LANDLORD_H
 
 #include "Caching.h"
+#include "CacheSnapshot.h"
 
-#include <set>
+#include <vector>
+#include <utility>
+#include <cassert>
 
 
 namespace  Caching {
-    typedef std::multiset<Term*, ReverseByLComparator> MinHeapByL;
+    //binary min-heap of terms by (L, term); every term knows its position, so
+    //erasing any term is O(log n) and nothing allocates once the capacity is there
+    class MinHeapByL {
+        IndexUpdate::TrackedVector<Term*, IndexUpdate::CacheHeapMemory> items;
+        ReverseByLComparator less;
 
-    class Landlord : public BaseCache {
+        inline void place(size_t i, Term* tptr) {
+            items[i] = tptr;
+            tptr->heapPos = i;
+        }
+
+        void siftUp(size_t i) {
+            Term* tptr = items[i];
+            while(i) {
+                auto parent = (i-1) >> 1;
+                if(!less(tptr, items[parent]))
+                    break;
+                place(i, items[parent]);
+                i = parent;
+            }
+            place(i, tptr);
+        }
+
+        void siftDown(size_t i) {
+            Term* tptr = items[i];
+            const auto sz = items.size();
+            for(auto child = 2*i+1; child < sz; child = 2*i+1) {
+                if(child+1 < sz && less(items[child+1], items[child]))
+                    ++child;
+                if(!less(items[child], tptr))
+                    break;
+                place(i, items[child]);
+                i = child;
+            }
+            place(i, tptr);
+        }
+    public:
+        typedef IndexUpdate::TrackedVector<Term*, IndexUpdate::CacheHeapMemory>::const_iterator const_iterator;
+
+        bool empty() const { return items.empty(); }
+        size_t size() const { return items.size(); }
+        const_iterator begin() const { return items.begin(); }
+        const_iterator end() const { return items.end(); }
+        void reserve(size_t n) { items.reserve(n); }
+
+        Term* top() const { return items.front(); }
+
+        void insert(Term* tptr) {
+            items.push_back(tptr);
+            siftUp(items.size()-1);
+        }
+
+        //no-op for a term that is not in the heap
+        void erase(Term* tptr) {
+            auto i = tptr->heapPos;
+            if(i == Term::notInHeap)
+                return;
+            assert(items[i] == tptr);
+            tptr->heapPos = Term::notInHeap;
+            Term* last = items.back();
+            items.pop_back();
+            if(i == items.size())
+                return;
+            place(i, last);
+            if(i && less(last, items[(i-1) >> 1]))
+                siftUp(i);
+            else
+                siftDown(i);
+        }
+
+        void pop() { erase(top()); }
+    };
+
+    inline uint64_t LFromLength(uint64_t len) { return len;}
+
+    //the landlord eviction logic, shared by the virtual (BaseCache) and the CRTP (StaticCache) flavours
+    template<typename Base>
+    class LandlordPolicy : public Base {
+    protected:
         size_t totalPostings;
         uint64_t accumulator;
         MinHeapByL heap;
+
+        //within a batch, a hit term leaves the heap once and is re-inserted only when
+        //the eviction order is needed (a miss that evicts) or when the batch ends
+        bool batching;
+        IndexUpdate::TrackedVector<Term*, IndexUpdate::CacheHeapMemory> detached;
+
+        ShadowList shadowList; //empty unless someone asks for the marginal utility
+
+        std::vector<std::pair<Term*, size_t> > stale; //of cohere, with their current lengths
+
+        //the tier below: where the victims go, if anywhere
+        std::vector<TermVisit>* victims;
+        bool admitting; //off: a miss doesn't place the term (a victim cache)
+
+        void evictTop() {
+            Term *tptr = heap.top();
+            assert(totalPostings >= tptr->length);
+            totalPostings -= tptr->length;
+            heap.pop();
+            shadowList.add(tptr->term, tptr->length);
+            if(victims)
+                victims->push_back(TermVisit(tptr->term, tptr->length));
+            Base::evict(tptr->term);
+        }
+
+        void attachDetached() {
+            for(auto tptr : detached) {
+                tptr->detached = false;
+                heap.insert(tptr);
+            }
+            detached.clear();
+        }
     public:
-        explicit Landlord(size_t maxPstings=0);
-        virtual std::string name() const { return "landlord1"; }
-        virtual size_t getTotalP() const { return totalPostings; }
+        explicit LandlordPolicy(size_t maxPstings=0) : totalPostings(0), accumulator(0), batching(false),
+                                                       victims(nullptr), admitting(true) {
+            this->maxPostings = maxPstings;
+        }
+        std::string name() const { return "landlord1"; }
+        size_t getTotalP() const { return totalPostings; }
+
+        void reserve(size_t terms) {
+            Base::reserve(terms);
+            heap.reserve(terms);
+            detached.reserve(terms);
+        }
+
+        //online resize: shrinking evicts by the landlord order right away
+        void setMaxPostings(size_t maxP) {
+            this->maxPostings = maxP;
+            if(totalPostings <= maxP)
+                return;
+            attachDetached();
+            while(totalPostings > maxP)
+                evictTop();
+        }
+
+        const ShadowList& shadow() const { return shadowList; }
+        void setShadowPostings(size_t maxPostings) { shadowList.setCapacity(maxPostings); }
+
+        //the terms it evicts are appended to sink (nullptr: nowhere)
+        void collectVictims(std::vector<TermVisit>* sink) { victims = sink; }
+        void admitOnMiss(bool admit) { admitting = admit; }
+
+        bool contains(term_t term) const {
+            auto tptr = this->lookup(term);
+            return tptr && tptr->length;
+        }
+
+        //the entries (cached terms and ghosts) by (L, term), for a snapshot; returns the landlord's clock
+        uint64_t save(std::vector<SnapshotEntry>& out) const;
+        //an empty cache takes the entries of save (in its order, so the heap grows in place:
+        //linear, and nothing allocates past the reserve); whatever is over maxPostings is evicted
+        void load(const SnapshotEntry* begin, const SnapshotEntry* end, uint64_t clock);
+
+        //coherence after the index changed: currentLength(term, cachedLength) of every cached term;
+        //a stale one is read again (refresh, if it still fits) or dropped, and staleTerm(cachedLength,
+        //currentLength, refreshed) is told about it. Not within a batch; returns how many were stale
+        template<typename CurrentLength, typename StaleTerm>
+        size_t cohere(CurrentLength currentLength, bool refresh, StaleTerm staleTerm);
+
+        //places a term without visiting it (a demotion from the tier above); not within a batch
+        void insert(term_t term, size_t length) {
+            assert(!batching);
+            if(this->maxPostings <= length)
+                return;
+            auto tptr = this->lookup(term);
+            if(!tptr) {
+                const bool admit = admitting;
+                admitting = true;
+                miss(term, length);
+                admitting = admit;
+                return;
+            }
+            hit(tptr, length);
+            while(totalPostings > this->maxPostings) //a ghost came back
+                evictTop();
+        }
+
+        //takes a term out (it moved to the tier above); not within a batch
+        void drop(term_t term) {
+            assert(!batching);
+            auto tptr = this->lookup(term);
+            if(!tptr || !tptr->length)
+                return;
+            heap.erase(tptr);
+            totalPostings -= tptr->length;
+            Base::evict(term);
+        }
     protected:
-        virtual void miss(term_t term, size_t length);
-        virtual void hit(Term* tptr, size_t length);
+        void miss(term_t term, size_t length);
+        void hit(Term* tptr, size_t length);
+        void beginBatch() { batching = true; }
+        void endBatch() {
+            attachDetached();
+            batching = false;
+        }
+    };
+
+    //virtual dispatch through CacheInterface
+    class Landlord : public LandlordPolicy<BaseCache> {
+    public:
+        explicit Landlord(size_t maxPstings=0);
+    };
+
+    //no virtual calls on the visit path
+    class StaticLandlord : public LandlordPolicy<StaticCache<StaticLandlord> > {
+        friend class StaticCache<StaticLandlord>;
+    public:
+        explicit StaticLandlord(size_t maxPstings=0) : LandlordPolicy(maxPstings) {}
     };
+
+    template<typename Base>
+    template<typename CurrentLength, typename StaleTerm>
+    size_t LandlordPolicy<Base>::cohere(CurrentLength currentLength, bool refresh, StaleTerm staleTerm) {
+        assert(!batching);
+        stale.clear();
+        for(auto tptr : heap) {
+            const size_t length = currentLength(tptr->term, tptr->length);
+            if(length != tptr->length)
+                stale.emplace_back(tptr, length);
+        }
+        for(const auto& entry : stale) {
+            Term* tptr = entry.first;
+            const bool refreshed = refresh && entry.second && entry.second < this->maxPostings;
+            staleTerm(tptr->length, entry.second, refreshed);
+            assert(totalPostings >= tptr->length);
+            totalPostings -= tptr->length;
+            if(refreshed) { //keeps its place in the landlord order
+                tptr->length = entry.second;
+                totalPostings += entry.second;
+            }
+            else {
+                heap.erase(tptr);
+                Base::evict(tptr->term);
+            }
+        }
+        while(totalPostings > this->maxPostings)
+            evictTop();
+        return stale.size();
+    }
+
+    template<typename Base>
+    uint64_t LandlordPolicy<Base>::save(std::vector<SnapshotEntry>& out) const {
+        std::vector<const Term*> terms;
+        this->entries(terms);
+        std::sort(terms.begin(), terms.end(), ReverseByLComparator());
+        out.clear();
+        out.reserve(terms.size());
+        for(auto tptr : terms)
+            out.push_back(SnapshotEntry{tptr->term, tptr->hitCount, tptr->length, tptr->L});
+        return accumulator;
+    }
+
+    template<typename Base>
+    void LandlordPolicy<Base>::load(const SnapshotEntry* begin, const SnapshotEntry* end, uint64_t clock) {
+        assert(heap.empty() && !totalPostings && !batching);
+        reserve(size_t(end - begin));
+        for(auto it = begin; it != end; ++it) {
+            Term* tptr = this->placeNew(it->term, it->length);
+            tptr->hitCount = it->hitCount;
+            tptr->L = it->L;
+            if(!it->length)
+                continue; //a ghost
+            totalPostings += it->length;
+            heap.insert(tptr);
+        }
+        accumulator = clock;
+        while(totalPostings > this->maxPostings)
+            evictTop();
+    }
+
+    template<typename Base>
+    void LandlordPolicy<Base>::miss(term_t term, size_t length) {
+        if(!detached.empty() && totalPostings + length > this->maxPostings)
+            attachDetached(); //about to evict: the heap must be exact
+        if(shadowList.enabled())
+            shadowList.visit(term, length);
+        if(!admitting)
+            return;
+        while (totalPostings > this->maxPostings) { //remove overflows!
+            assert(!heap.empty());
+            evictTop();
+        }
+        while (totalPostings + length > this->maxPostings) { //evict to accommodate with bound size policy
+            assert(!heap.empty());
+            Term *tptr = heap.top();
+            if(tptr->L > accumulator)
+                return; //don't add it!
+            if(!this->admits(term, tptr->term)) {
+                ++this->cacheNotAdmitted;
+                return;
+            }
+
+            evictTop();
+        }
+        Term *tptr = this->placeNew(term, length);
+        accumulator +=  LFromLength(length);
+        tptr->L = accumulator;
+        totalPostings += length;
+        heap.insert(tptr);
+    }
+    template<typename Base>
+    void LandlordPolicy<Base>::hit(Term *tptr, size_t newLength) {
+        if(!tptr->length && shadowList.enabled()) //a ghost entry: missed
+            shadowList.visit(tptr->term, newLength);
+        if(!tptr->length && this->maxPostings <= newLength) { //a ghost that no longer fits stays one
+            ++this->cacheRejected;
+            return;
+        }
+        if(!tptr->detached)
+            heap.erase(tptr); //erase first, since
+        ++(tptr->hitCount); //could be violating the map now!
+        uint64_t mult = 1; // tptr->hitCount
+        tptr->L = accumulator + (LFromLength(newLength) * mult); //reset L
+        if(tptr->length != newLength) { //a ghost coming back, or stale: patched here unless cohere keeps it current
+            if(tptr->length)
+                ++this->cacheStaleHits;
+            assert(totalPostings >= tptr->length);
+            totalPostings -= tptr->length;
+            totalPostings += newLength;
+            tptr->length = newLength;
+        }
+        if(!batching)
+            heap.insert(tptr);
+        else if(!tptr->detached) {
+            tptr->detached = true;
+            detached.push_back(tptr);
+        }
+    }
 }
 #endif //CACHING_LANDLORD_H
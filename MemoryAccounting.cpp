@@ -0,0 +1,40 @@
+#include "MemoryAccounting.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace IndexUpdate {
+
+    MemoryCounter& memoryCounter(MemorySubsystem subsystem) {
+        static MemoryCounter counters[memorySubsystems] = {}; //zeroed before any allocation
+        return counters[subsystem];
+    }
+
+    uint64_t peakRssBytes() {
+#if defined(__unix__) || defined(__APPLE__)
+        struct rusage usage;
+        if(getrusage(RUSAGE_SELF, &usage))
+            return 0;
+#if defined(__APPLE__)
+        return uint64_t(usage.ru_maxrss); //bytes
+#else
+        return uint64_t(usage.ru_maxrss) * 1024; //KB
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    void reportMemory(std::ostream& out) {
+        static const char* names[memorySubsystems] = {"cache-table", "cache-heap", "segments", "scratch"};
+        const double mb = 1024.0 * 1024.0;
+        out << " Memory-MB(current/peak/allocations):";
+        for(unsigned i = 0; i < memorySubsystems; ++i) {
+            const MemoryCounter& counter = memoryCounter(MemorySubsystem(i));
+            out << " " << names[i] << ": " << double(counter.current.load()) / mb << "/" <<
+                double(counter.peak.load()) / mb << "/" << counter.allocations.load();
+        }
+        out << " peak-rss-MB: " << double(peakRssBytes()) / mb;
+    }
+}
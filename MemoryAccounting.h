@@ -0,0 +1,75 @@
+#ifndef UPDATE_LITE_MEMORYACCOUNTING_H
+#define UPDATE_LITE_MEMORYACCOUNTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace IndexUpdate {
+
+    //where the memory of the big containers goes
+    enum MemorySubsystem {
+        CacheTableMemory, //the cache's lookup table, its entries and their sketch
+        CacheHeapMemory, //the eviction order of the cache
+        SegmentMemory, //the segment sizes of the packs (and of the monolithic index)
+        ScratchMemory, //the consolidation prices and merge scratch
+        memorySubsystems
+    };
+
+    //process wide: the simulations running at once share them
+    struct MemoryCounter {
+        std::atomic<int64_t> current;
+        std::atomic<int64_t> peak;
+        std::atomic<uint64_t> allocations;
+    };
+    MemoryCounter& memoryCounter(MemorySubsystem subsystem);
+
+    inline void accountAllocation(MemorySubsystem subsystem, size_t bytes) {
+        MemoryCounter& counter = memoryCounter(subsystem);
+        const int64_t now = counter.current.fetch_add(int64_t(bytes), std::memory_order_relaxed) + int64_t(bytes);
+        int64_t peak = counter.peak.load(std::memory_order_relaxed);
+        while(now > peak && !counter.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+            continue;
+        counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    inline void accountRelease(MemorySubsystem subsystem, size_t bytes) {
+        memoryCounter(subsystem).current.fetch_sub(int64_t(bytes), std::memory_order_relaxed);
+    }
+
+    //std::allocator that charges the subsystem
+    template<typename T, MemorySubsystem Subsystem>
+    struct TrackingAllocator {
+        typedef T value_type;
+        template<typename U> struct rebind { typedef TrackingAllocator<U, Subsystem> other; };
+
+        TrackingAllocator() {}
+        template<typename U> TrackingAllocator(const TrackingAllocator<U, Subsystem>&) {}
+
+        T* allocate(size_t n) {
+            accountAllocation(Subsystem, n * sizeof(T));
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T* p, size_t n) {
+            accountRelease(Subsystem, n * sizeof(T));
+            std::allocator<T>().deallocate(p, n);
+        }
+    };
+    template<typename T, typename U, MemorySubsystem Subsystem>
+    bool operator==(const TrackingAllocator<T, Subsystem>&, const TrackingAllocator<U, Subsystem>&) { return true; }
+    template<typename T, typename U, MemorySubsystem Subsystem>
+    bool operator!=(const TrackingAllocator<T, Subsystem>&, const TrackingAllocator<U, Subsystem>&) { return false; }
+
+    template<typename T, MemorySubsystem Subsystem>
+    using TrackedVector = std::vector<T, TrackingAllocator<T, Subsystem> >;
+
+    //the peak resident set of the process (0 where unknown)
+    uint64_t peakRssBytes();
+
+    //current/peak MB and allocations of every subsystem, and the peak RSS
+    void reportMemory(std::ostream& out);
+}
+
+#endif //UPDATE_LITE_MEMORYACCOUNTING_H
@@ -0,0 +1,58 @@
+#include "MemoryPartition.h"
+
+#include <algorithm>
+
+namespace IndexUpdate {
+
+    MemoryPartition::MemoryPartition() :
+            total(0), ub(0), cache(0), stepPostings(0), minSide(0),
+            mergeRate(0), shadowRate(0), servedRate(0), decisions(0), toCache(0), toUB(0), ubPctSum(0) {}
+
+    void MemoryPartition::init(const Settings& settings) {
+        policy = settings.memory;
+        ub = settings.updateBufferPostingsLimit;
+        cache = settings.cacheSizePostings;
+        total = ub + cache;
+        stepPostings = total * policy.stepPermille / 1000;
+        minSide = total * policy.minPercent / 100;
+        mergeRate = shadowRate = servedRate = ubPctSum = 0;
+        decisions = toCache = toUB = 0;
+    }
+
+    bool MemoryPartition::decide(double mergeMinutes, double servedMinutes, double shadowMinutes, uint64_t postings) {
+        if(!postings || !stepPostings)
+            return false;
+        const double smoothing = 0.3;
+        const double merge = mergeMinutes / double(postings);
+        const double shadow = shadowMinutes / double(postings);
+        const double served = servedMinutes / double(postings);
+        mergeRate = decisions ? smoothing * merge + (1 - smoothing) * mergeRate : merge;
+        shadowRate = decisions ? smoothing * shadow + (1 - smoothing) * shadowRate : shadow;
+        servedRate = decisions ? smoothing * served + (1 - smoothing) * servedRate : served;
+        ++decisions;
+        ubPctSum += double(ub) / double(total) * 100.0;
+
+        const double ubGain = mergeRate * double(stepPostings) / double(ub);
+        const double cacheGain = std::min(shadowRate, servedRate * double(stepPostings) / double(cache));
+        const double hysteresis = 1.1;
+        if(cacheGain > ubGain * hysteresis && ub >= minSide + stepPostings) {
+            ub -= stepPostings;
+            cache += stepPostings;
+            ++toCache;
+            return true;
+        }
+        if(ubGain > cacheGain * hysteresis && cache >= minSide + stepPostings) {
+            cache -= stepPostings;
+            ub += stepPostings;
+            ++toUB;
+            return true;
+        }
+        return false;
+    }
+
+    void MemoryPartition::report(std::ostream& out) const {
+        out << " Memory: ub-postings: " << ub << " cache-postings: " << cache
+            << " to-cache: " << toCache << " to-ub: " << toUB
+            << " ub-mean-pct: " << (decisions ? ubPctSum / double(decisions) : double(ub) / double(total) * 100.0);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef UPDATE_LITE_MEMORYPARTITION_H
+#define UPDATE_LITE_MEMORYPARTITION_H
+
+#include <cstdint>
+#include <ostream>
+
+#include "Settings.h"
+
+namespace IndexUpdate {
+
+    //moves memory between the update buffer and the cache, one step at an eviction, toward the
+    //side with the larger marginal gain. The cache's is measured on a shadow of one step (what a
+    //step more of cache would have served), capped by the average gain of a step of the cache
+    //in place (a concave hit curve; landlord may not keep what the shadow says it could).
+    //The buffer's is estimated from the merge work and the seeks of the queries to the extra
+    //segments, which go down as 1/buffer size since the evictions space out
+    class MemoryPartition {
+        MemoryAdaptation policy;
+        uint64_t total;
+        uint64_t ub;
+        uint64_t cache;
+        uint64_t stepPostings;
+        uint64_t minSide;
+
+        double mergeRate; //minutes per ingested posting (EWMA over evictions)
+        double shadowRate;
+        double servedRate;
+        unsigned decisions;
+        unsigned toCache;
+        unsigned toUB;
+        double ubPctSum;
+    public:
+        MemoryPartition();
+
+        void init(const Settings& settings);
+        bool enabled() const { return policy.adaptive; }
+
+        uint64_t updateBuffer() const { return ub; }
+        uint64_t cacheSize() const { return cache; }
+        uint64_t step() const { return stepPostings; }
+
+        //an eviction spent mergeMinutes (with the extra seeks of the queries before it), the cache saved servedMinutes and the shadow would have saved
+        //shadowMinutes more, over postings ingested since the previous one; true if the split moved
+        bool decide(double mergeMinutes, double servedMinutes, double shadowMinutes, uint64_t postings);
+
+        void report(std::ostream& out) const;
+    };
+}
+
+#endif //UPDATE_LITE_MEMORYPARTITION_H
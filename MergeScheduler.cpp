@@ -0,0 +1,44 @@
+#include "MergeScheduler.h"
+
+namespace IndexUpdate {
+
+    MergeScheduler::MergeScheduler() :
+            ioMBS(0), ioSeek(0), postingBytes(0), budgetBytesPerMs(0),
+            streams(1), highLoad(false), lowLoadSince(0),
+            jobs(0), deferred(0), maxBacklog(0), lagMs(0), maxLagMs(0), busyMs(0) {}
+
+    void MergeScheduler::init(const Settings& settings) {
+        policy = settings.merging;
+        ioMBS = settings.ioMBS;
+        ioSeek = settings.ioSeek;
+        postingBytes = settings.szOfPostingBytes;
+        budgetBytesPerMs = double(uint64_t(policy.budgetMBS) << 20) / 1000.0;
+        streams = std::max(settings.mergeMemory.streams, 1u);
+        waiting.clear();
+        running.clear();
+        idleSince.assign(streams, 0); //all zero, a heap already
+        highLoad = false;
+        lowLoadSince = 0;
+        jobs = deferred = 0;
+        maxBacklog = 0;
+        lagMs = maxLagMs = busyMs = 0;
+    }
+
+    double MergeScheduler::durationMs(const ConsolidationStats& cost) const {
+        double ms = ioLatencyMs(cost.reads, ioMBS, ioSeek, postingBytes) +
+                    ioLatencyMs(cost.writes, ioMBS, ioSeek, postingBytes);
+        if(budgetBytesPerMs > 0)
+            ms = std::max(ms, double((cost.reads.postings + cost.writes.postings) * postingBytes) / budgetBytesPerMs);
+        return ms;
+    }
+
+    void MergeScheduler::report(std::ostream& out) const {
+        out << " Merge-queue: merges: " << jobs << " deferred: " << deferred
+            << " max-backlog: " << maxBacklog
+            << " lag-mean-minutes: " << (jobs ? lagMs / double(jobs) / 60000.0 : 0.0)
+            << " lag-max-minutes: " << maxLagMs / 60000.0
+            << " stream-busy-minutes: " << busyMs / 60000.0;
+        if(streams > 1)
+            out << " streams: " << streams;
+    }
+}
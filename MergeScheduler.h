@@ -0,0 +1,127 @@
+#ifndef UPDATE_LITE_MERGESCHEDULER_H
+#define UPDATE_LITE_MERGESCHEDULER_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "Settings.h"
+#include "Consolidation.h"
+
+namespace IndexUpdate {
+
+    //background merge streams (MergeMemory::streams): merges start in submission order on the first
+    //free stream, each taking the longer of its serial disk time and its bytes over the bandwidth
+    //budget, times the streams busy when it starts (they share the device and the budget).
+    //While the query rate is above MergeSchedule::deferAboveQps the queue is held back
+    //(up to maxDeferSec per merge), so the merges drift into the quieter periods.
+    class MergeScheduler {
+    public:
+        struct Job {
+            double submitMs;
+            double startMs;
+            double doneMs;
+            int packId; //-1: all the packs (monolithic index)
+            unsigned unmergedSegments; //what the queries keep seeing until doneMs
+            ConsolidationStats cost;
+        };
+    private:
+        MergeSchedule policy;
+        unsigned ioMBS;
+        double ioSeek;
+        unsigned postingBytes;
+        double budgetBytesPerMs; //0: no budget
+
+        std::deque<Job> waiting;
+        std::vector<Job> running; //a stream each
+        std::vector<double> idleSince; //the free streams, a min-heap
+        unsigned streams;
+        bool highLoad;
+        double lowLoadSince;
+
+        uint64_t jobs;
+        uint64_t deferred;
+        size_t maxBacklog;
+        double lagMs; //submission to completion
+        double maxLagMs;
+        double busyMs;
+
+        double durationMs(const ConsolidationStats& cost) const;
+    public:
+        MergeScheduler();
+
+        void init(const Settings& settings);
+        bool enabled() const { return policy.background; }
+        double budget() const { return budgetBytesPerMs; }
+
+        void submit(double nowMs, int packId, unsigned unmergedSegments, const ConsolidationStats& cost) {
+            waiting.push_back(Job{nowMs, 0, 0, packId, unmergedSegments, cost});
+            maxBacklog = std::max(maxBacklog, waiting.size() + running.size());
+        }
+
+        //moves the stream to nowMs, with queries arriving at qps at the moment;
+        //calls started(job) and done(job) in time order
+        template<typename Started, typename Done>
+        void advance(double nowMs, double qps, Started started, Done done);
+
+        void report(std::ostream& out) const;
+    };
+
+    template<typename Started, typename Done>
+    void MergeScheduler::advance(double nowMs, double qps, Started started, Done done) {
+        const bool busy = policy.deferAboveQps > 0 && qps > policy.deferAboveQps;
+        if(busy)
+            highLoad = true;
+        else if(highLoad) { //noticed at the first query after the peak
+            highLoad = false;
+            lowLoadSince = nowMs;
+        }
+        const double maxDeferMs = policy.maxDeferSec * 1000.0;
+        const auto byDone = [](const Job& a, const Job& b) { return a.doneMs < b.doneMs; };
+        for(;;) {
+            //the next start, if a stream is free
+            const bool startable = !waiting.empty() && !idleSince.empty();
+            double ready = 0, start = std::numeric_limits<double>::infinity();
+            if(startable) {
+                const Job& job = waiting.front();
+                ready = std::max(idleSince.front(), job.submitMs);
+                start = ready;
+                if(busy)
+                    start = std::max(start, job.submitMs + maxDeferMs);
+                else if(policy.deferAboveQps > 0)
+                    start = std::max(start, lowLoadSince);
+            }
+            const auto first = std::min_element(running.begin(), running.end(), byDone);
+            if(first != running.end() && first->doneMs <= nowMs && first->doneMs <= start) {
+                const Job finished = *first;
+                running.erase(first);
+                idleSince.push_back(finished.doneMs);
+                std::push_heap(idleSince.begin(), idleSince.end(), std::greater<double>());
+                lagMs += finished.doneMs - finished.submitMs;
+                maxLagMs = std::max(maxLagMs, finished.doneMs - finished.submitMs);
+                done(finished);
+                continue;
+            }
+            if(!startable || start > nowMs)
+                return;
+            if(start > ready)
+                ++deferred;
+            std::pop_heap(idleSince.begin(), idleSince.end(), std::greater<double>());
+            idleSince.pop_back();
+            Job job = waiting.front();
+            waiting.pop_front();
+            job.startMs = start;
+            job.doneMs = start + durationMs(job.cost) * double(running.size() + 1);
+            busyMs += job.doneMs - start;
+            ++jobs;
+            running.push_back(job);
+            started(job);
+        }
+    }
+}
+
+#endif //UPDATE_LITE_MERGESCHEDULER_H
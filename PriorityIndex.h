@@ -0,0 +1,101 @@
+#ifndef UPDATE_LITE_PRIORITYINDEX_H
+#define UPDATE_LITE_PRIORITYINDEX_H
+
+#include <cstddef>
+#include <vector>
+#include <cassert>
+
+namespace IndexUpdate {
+
+    //max-heap of the ids 0..n-1 by a key; every id knows its position, so re-keying or
+    //removing one is O(log n) and the index only has to be told what changed
+    class PriorityIndex {
+        struct Entry {
+            double key;
+            unsigned id;
+        };
+        std::vector<Entry> heap;
+        std::vector<size_t> pos; //npos if not in the heap
+
+        static const size_t npos = size_t(-1);
+
+        //larger key first, on ties the larger id
+        static bool before(const Entry& a, const Entry& b) {
+            return a.key != b.key ? a.key > b.key : a.id > b.id;
+        }
+
+        void place(size_t i, const Entry& e) {
+            heap[i] = e;
+            pos[e.id] = i;
+        }
+
+        void siftUp(size_t i) {
+            Entry e = heap[i];
+            while(i) {
+                auto parent = (i-1) >> 1;
+                if(!before(e, heap[parent]))
+                    break;
+                place(i, heap[parent]);
+                i = parent;
+            }
+            place(i, e);
+        }
+
+        void siftDown(size_t i) {
+            Entry e = heap[i];
+            const auto sz = heap.size();
+            for(auto child = 2*i+1; child < sz; child = 2*i+1) {
+                if(child+1 < sz && before(heap[child+1], heap[child]))
+                    ++child;
+                if(!before(heap[child], e))
+                    break;
+                place(i, heap[child]);
+                i = child;
+            }
+            place(i, e);
+        }
+    public:
+        void reset(size_t ids) {
+            heap.clear();
+            pos.assign(ids, size_t(npos));
+        }
+
+        bool empty() const { return heap.empty(); }
+        size_t size() const { return heap.size(); }
+        unsigned top() const { return heap.front().id; }
+        double topKey() const { return heap.front().key; }
+
+        //inserts id or moves it to its new key
+        void update(unsigned id, double key) {
+            assert(id < pos.size());
+            if(pos[id] == npos) {
+                heap.push_back(Entry{key, id});
+                pos[id] = heap.size()-1;
+                siftUp(heap.size()-1);
+                return;
+            }
+            auto i = pos[id];
+            const bool up = key > heap[i].key;
+            heap[i].key = key;
+            up ? siftUp(i) : siftDown(i);
+        }
+
+        void erase(unsigned id) {
+            auto i = pos[id];
+            if(i == npos)
+                return;
+            pos[id] = npos;
+            Entry last = heap.back();
+            heap.pop_back();
+            if(i == heap.size())
+                return;
+            place(i, last);
+            if(i && before(last, heap[(i-1) >> 1]))
+                siftUp(i);
+            else
+                siftDown(i);
+        }
+    };
+}
+
+#endif //UPDATE_LITE_PRIORITYINDEX_H
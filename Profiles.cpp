@@ -0,0 +1,162 @@
+#include "Profiles.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace IndexUpdate {
+    Settings Profiles::training(DiskType disk, unsigned queriesQuant) {
+        Settings sets;
+        sets.diskType = disk;
+        if(HD == disk) {
+            sets.ioMBS = 150; //how many MB per second we can read/write
+            sets.ioSeek = 7; //the time to make an average seek (random access latency)
+            //one head: serial and symmetric
+            sets.device.channels = 1;
+            sets.device.queueDepth = 1;
+            sets.device.readMBS = sets.device.writeMBS = sets.ioMBS;
+            sets.device.readLatency = sets.device.writeLatency = sets.ioSeek;
+        }
+        else if (SSD == disk){ //from Samsung
+            sets.ioMBS = 500; //how many MB per second we can read/write
+            sets.ioSeek = 0.0625; //the time to make an average seek (random access latency)
+            //flash: many requests in flight, programs are slower than reads
+            sets.device.channels = 8;
+            sets.device.queueDepth = 32;
+            sets.device.readMBS = sets.ioMBS;
+            sets.device.writeMBS = 450;
+            sets.device.readLatency = sets.ioSeek;
+            sets.device.writeLatency = 0.25;
+        }
+        sets.quieriesQuant = queriesQuant;
+
+        sets.szOfPostingBytes = 4; //we use fixed size of postings (in bytes).
+        sets.updatesQuant = 1000*1000;
+        sets.percentsUBLeft = 25;
+
+        if(HD == disk) {
+            //for HD
+            sets.tpMembers = {
+                    21,35,50,69,
+                    88,109,139,173,
+                    213,261,323,401,
+                    489,618,838,1206,
+                    1776,3208,8213,33396,
+                    2262672
+            };
+            //64
+            sets.tpQueries = {
+                    24121,23619,23471,23490,
+                    23739,23537,23909,23436,
+                    23638,23529,23558,23565,
+                    23465,23798,23885,23591,
+                    23550,23559,23513,23700,
+                    23826};
+
+            sets.tpUpdates = {
+                    424141246,422228256,420319852,419876347,
+                    423493286,419725298,421212817,420285949,
+                    421057945,420528111,420271342,419493211,
+                    420077546,419777985,419348858,419560157,
+                    419308877,419278178,419272221,419296846,
+                    419312938,
+            };
+        }
+        else {
+            sets.tpQueries = {
+                    11782,11566,11459,11292,
+                    11286,11110,11094,11304,
+                    11035,11024,11243,11176,
+                    11192,11143,11217,11185,
+                    11003,11021,11299,11217,
+                    10985,11152,11039,11157,
+                    11119,10987,11101,11003,
+                    11288,11245,11276,11299,
+                    11092,11029,11088,11129,
+                    11121,11066,11057,11009,
+                    11202,11239,11134,11326,
+                    10948	
+            };
+            sets.tpUpdates = {
+                    195705322,196349764,195399697,194151434,
+                    190936261,191261649,190209710,192363674,
+                    188647608,188619532,188937977,190359610,
+                    190364053,189135695,189732419,189071817,
+                    190226539,190044871,190089281,189533200,
+                    189405216,188879566,188910233,189048263,
+                    189482970,189194333,189319583,188629060,
+                    189130332,188608975,188784441,188856017,
+                    188622468,188843689,188692968,188603141,
+                    188582983,188682550,188553502,188609506,
+                    188603367,188585978,188573692,188582030,
+                    188599756,
+            };
+            sets.tpMembers = {
+                    8, 12, 15, 18,
+                    21,25,29,34,
+                    37,41,46,51,
+                    57, 64,71,79,
+                    87,96,106,116,
+                    128,141,156,174,
+                    192,212,231,252,
+                    288,328,381,444,
+                    532,637,757,924,
+                    1213,1704,2583,4273,
+                    7605,15724,43332,230072,
+                    57503262	
+            };
+        }
+        return sets;
+    }
+
+    Settings Profiles::shard(const Settings& cluster, unsigned shards) {
+        Settings node(cluster);
+        node.shards = 0;
+        node.totalExperimentPostings = cluster.totalExperimentPostings / shards;
+        node.updateBufferPostingsLimit = cluster.updateBufferPostingsLimit / shards;
+        node.cacheSizePostings = cluster.cacheSizePostings / shards;
+        node.mergeMemory.postings = cluster.mergeMemory.postings / shards;
+        node.cacheTier.postings = cluster.cacheTier.postings / shards;
+        //the same query stream per a node's own postings
+        node.updatesQuant = cluster.updatesQuant / shards;
+        node.device.ingestPostingsPerSec = cluster.device.ingestPostingsPerSec / shards;
+        return node;
+    }
+
+    WorkloadProfile Profiles::workload(const std::string& path) {
+        std::ifstream in(path);
+        if(!in)
+            throw std::runtime_error("cannot open the workload profile " + path);
+        WorkloadProfile profile;
+        std::string line;
+        for(unsigned lineNo = 1; std::getline(in, line); ++lineNo) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string first;
+            if(!(fields >> first))
+                continue;
+            const std::string where = path + ":" + std::to_string(lineNo);
+            if(first == "period") {
+                if(!(fields >> profile.periodSec) || profile.periodSec <= 0)
+                    throw std::runtime_error(where + ": bad period");
+                continue;
+            }
+            WorkloadPiece piece;
+            std::istringstream start(first);
+            if(!(start >> piece.startSec) || !(fields >> piece.updateRate >> piece.queryRate))
+                throw std::runtime_error(where + ": expected start-sec update-rate query-rate");
+            std::string weight;
+            while(fields >> weight) {
+                const auto colon = weight.find(':');
+                if(colon == std::string::npos)
+                    throw std::runtime_error(where + ": expected pack:weight, got " + weight);
+                piece.packUpdates.emplace_back(unsigned(std::stoul(weight.substr(0, colon))),
+                                               std::stod(weight.substr(colon + 1)));
+            }
+            profile.pieces.push_back(piece);
+        }
+        if(profile.pieces.empty())
+            throw std::runtime_error("no pieces in the workload profile " + path);
+        return profile;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef UPDATE_LITE_PROFILES_H
+#define UPDATE_LITE_PROFILES_H
+
+#include <string>
+
+#include "Settings.h"
+
+namespace IndexUpdate {
+
+    namespace Profiles {
+        //disk parameters and TermPack data (based on our training set); totalExperimentPostings is left to the caller
+        Settings training(DiskType disk, unsigned queriesQuant = 64);
+
+        //one of the shards of a document-partitioned cluster described by cluster:
+        //a node gets its share of the postings, the memory budgets (merges too) and the ingest rate,
+        //and sees every query
+        Settings shard(const Settings& cluster, unsigned shards);
+
+        //a WorkloadProfile from a text file, one piece a line: start-sec update-rate query-rate
+        //[pack:weight ...], and optionally "period <sec>"; # starts a comment.
+        //Throws std::runtime_error on a file it cannot read
+        WorkloadProfile workload(const std::string& path);
+    }
+}
+
+#endif //UPDATE_LITE_PROFILES_H
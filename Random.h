@@ -0,0 +1,62 @@
+#ifndef UPDATE_LITE_RANDOM_H
+#define UPDATE_LITE_RANDOM_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace IndexUpdate {
+
+    //counter-based generator (Widynski's "Squares"): the i-th number of a stream is a pure
+    //function of (key, i), so independent streams need no shared state and are reproducible
+    class CounterRNG {
+        uint64_t key;
+        uint64_t counter;
+
+        static uint64_t keyOf(uint64_t stream) { //splitmix64 finalizer, keys must be odd
+            uint64_t z = stream + 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return (z ^ (z >> 31)) | 1;
+        }
+    public:
+        explicit CounterRNG(uint64_t stream = 0) : key(keyOf(stream)), counter(0) {}
+
+        uint32_t next() {
+            uint64_t x, y, z;
+            y = x = (counter++) * key;
+            z = y + key;
+            x = x*x + y; x = (x >> 32) | (x << 32);
+            x = x*x + z; x = (x >> 32) | (x << 32);
+            x = x*x + y; x = (x >> 32) | (x << 32);
+            return uint32_t((x*x + z) >> 32);
+        }
+
+        //in [0,1)
+        double uniform() { return next() * (1.0 / 4294967296.0); }
+    };
+
+    //picks an index with probability proportional to its weight
+    class DiscreteSampler {
+        std::vector<double> cdf;
+    public:
+        template<typename IT>
+        void init(IT begin, IT end) {
+            cdf.clear();
+            double acc = 0;
+            for(; begin != end; ++begin)
+                cdf.push_back(acc += double(*begin));
+            assert(!cdf.empty() && acc > 0);
+            for(auto& c : cdf)
+                c /= acc;
+        }
+
+        unsigned operator()(CounterRNG& rng) const {
+            auto it = std::upper_bound(cdf.begin(), cdf.end(), rng.uniform());
+            return unsigned(std::min<size_t>(it - cdf.begin(), cdf.size()-1));
+        }
+    };
+}
+
+#endif //UPDATE_LITE_RANDOM_H
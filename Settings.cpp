@@ -10,11 +10,23 @@ namespace IndexUpdate {
         return
             hashMe(s.ioMBS) ^
             hashMe(s.ioSeek) ^
-            hashMe(s.szOfPostingBytes) ^
+            hashMe(s.szOfPostingBytes) ^ hashMe(int(s.compression.codec)) ^ hashMe(s.compression.termsPerDoc) ^
             hashMe(s.totalExperimentPostings) ^
             hashMe(s.updateBufferPostingsLimit) ^
             hashMe(s.updatesQuant) ^
-            hashMe(s.quieriesQuant) ^ hashMe(s.percentsUBLeft);
+            hashMe(s.quieriesQuant) ^ hashMe(s.percentsUBLeft) ^ hashMe(int(s.evictionOrder)) ^ hashMe(s.flushPostings) ^
+            hashMe(s.deletes.perPosting) ^ hashMe(s.deletes.garbageTrigger) ^
+            hashMe(s.cacheSketchTerms) ^ hashMe(int(s.coherence)) ^ hashMe(s.cacheTier.postings) ^ hashMe(int(s.cacheTier.inclusion)) ^ hashMe(s.filterBitsPerKey) ^
+            hashMe(s.queryStream) ^ hashMe(s.replicas) ^ hashMe(s.replicaPrecision) ^ hashMe(s.shards) ^ hashMe(s.packThreads) ^ hashMe(s.telemetry.prefix) ^ hashMe(s.telemetry.everyQueries) ^ hashMe(s.reportMemory) ^
+            hashMe(s.snapshots.load) ^ hashMe(s.snapshots.save) ^
+            hashMe(s.device.timeline) ^ hashMe(s.device.channels) ^ hashMe(s.device.queueDepth) ^
+            hashMe(s.workload.pieces.size()) ^ hashMe(s.workload.periodSec) ^
+            hashMe(s.merging.background) ^ hashMe(s.merging.budgetMBS) ^ hashMe(s.merging.deferAboveQps) ^
+            hashMe(s.mergeMemory.postings) ^ hashMe(s.mergeMemory.streams) ^ hashMe(s.mergeMemory.fromCache) ^
+            hashMe(s.memory.adaptive) ^ hashMe(s.memory.stepPermille) ^
+            hashMe(s.prognosis.smoothing) ^ hashMe(s.prognosis.maxHorizonBuffers) ^
+            hashMe(s.packPolicies.reevaluateEvictions) ^ hashMe(s.packPolicies.neverBelow) ^
+            hashMe(s.packPolicies.logAbove);
     }
 
     bool operator==(const Settings& lhs, const Settings& rhs) {
@@ -22,11 +34,131 @@ namespace IndexUpdate {
             lhs.ioMBS == rhs.ioMBS &&
             lhs.ioSeek == rhs.ioSeek &&
             lhs.szOfPostingBytes == rhs.szOfPostingBytes &&
+            lhs.compression == rhs.compression &&
             lhs.totalExperimentPostings == rhs.totalExperimentPostings &&
             lhs.updateBufferPostingsLimit == rhs.updateBufferPostingsLimit &&
             lhs.updatesQuant == rhs.updatesQuant &&
             lhs.quieriesQuant == rhs.quieriesQuant &&
-            lhs.percentsUBLeft == rhs.percentsUBLeft;
+            lhs.deletes == rhs.deletes &&
+            lhs.percentsUBLeft == rhs.percentsUBLeft &&
+            lhs.evictionOrder == rhs.evictionOrder &&
+            lhs.flushPostings == rhs.flushPostings &&
+            lhs.cacheSketchTerms == rhs.cacheSketchTerms &&
+            lhs.cacheTier == rhs.cacheTier &&
+            lhs.filterBitsPerKey == rhs.filterBitsPerKey &&
+            lhs.coherence == rhs.coherence &&
+            lhs.queryStream == rhs.queryStream &&
+            lhs.replicas == rhs.replicas &&
+            lhs.replicaPrecision == rhs.replicaPrecision &&
+            lhs.shards == rhs.shards &&
+            lhs.packThreads == rhs.packThreads &&
+            lhs.telemetry == rhs.telemetry &&
+            lhs.snapshots == rhs.snapshots &&
+            lhs.reportMemory == rhs.reportMemory &&
+            lhs.device == rhs.device &&
+            lhs.merging == rhs.merging &&
+            lhs.mergeMemory == rhs.mergeMemory &&
+            lhs.workload == rhs.workload &&
+            lhs.memory == rhs.memory &&
+            lhs.prognosis == rhs.prognosis &&
+            lhs.packPolicies == rhs.packPolicies;
+    }
+
+    bool operator==(const DeviceModel& lhs, const DeviceModel& rhs) {
+        return
+            lhs.timeline == rhs.timeline &&
+            lhs.channels == rhs.channels &&
+            lhs.queueDepth == rhs.queueDepth &&
+            lhs.readMBS == rhs.readMBS &&
+            lhs.writeMBS == rhs.writeMBS &&
+            lhs.readLatency == rhs.readLatency &&
+            lhs.writeLatency == rhs.writeLatency &&
+            lhs.maxRequestBytes == rhs.maxRequestBytes &&
+            lhs.ingestPostingsPerSec == rhs.ingestPostingsPerSec;
+    }
+
+    bool operator==(const MergeSchedule& lhs, const MergeSchedule& rhs) {
+        return
+            lhs.background == rhs.background &&
+            lhs.budgetMBS == rhs.budgetMBS &&
+            lhs.deferAboveQps == rhs.deferAboveQps &&
+            lhs.maxDeferSec == rhs.maxDeferSec;
+    }
+
+    bool operator==(const MergeMemory& lhs, const MergeMemory& rhs) {
+        return
+            lhs.postings == rhs.postings &&
+            lhs.streams == rhs.streams &&
+            lhs.fromCache == rhs.fromCache;
+    }
+
+    bool operator==(const MemoryAdaptation& lhs, const MemoryAdaptation& rhs) {
+        return
+            lhs.adaptive == rhs.adaptive &&
+            lhs.stepPermille == rhs.stepPermille &&
+            lhs.minPercent == rhs.minPercent;
+    }
+
+    bool operator==(const Prognosis& lhs, const Prognosis& rhs) {
+        return
+            lhs.smoothing == rhs.smoothing &&
+            lhs.maxHorizonBuffers == rhs.maxHorizonBuffers;
+    }
+
+    bool operator==(const PackPolicies& lhs, const PackPolicies& rhs) {
+        return
+            lhs.reevaluateEvictions == rhs.reevaluateEvictions &&
+            lhs.neverBelow == rhs.neverBelow &&
+            lhs.logAbove == rhs.logAbove;
+    }
+
+    bool operator==(const Deletes& lhs, const Deletes& rhs) {
+        return
+            lhs.perPosting == rhs.perPosting &&
+            lhs.garbageTrigger == rhs.garbageTrigger;
+    }
+
+    bool operator==(const WorkloadPiece& lhs, const WorkloadPiece& rhs) {
+        return
+            lhs.startSec == rhs.startSec &&
+            lhs.updateRate == rhs.updateRate &&
+            lhs.queryRate == rhs.queryRate &&
+            lhs.packUpdates == rhs.packUpdates;
+    }
+
+    bool operator==(const WorkloadProfile& lhs, const WorkloadProfile& rhs) {
+        return
+            lhs.pieces == rhs.pieces &&
+            lhs.periodSec == rhs.periodSec;
+    }
+
+    bool operator==(const Telemetry& lhs, const Telemetry& rhs) {
+        return
+            lhs.prefix == rhs.prefix &&
+            lhs.everyQueries == rhs.everyQueries;
+    }
+
+    bool operator==(const CacheSnapshots& lhs, const CacheSnapshots& rhs) {
+        return
+            lhs.load == rhs.load &&
+            lhs.save == rhs.save;
+    }
+
+    bool operator==(const CacheTier& lhs, const CacheTier& rhs) {
+        return
+            lhs.postings == rhs.postings &&
+            lhs.ioMBS == rhs.ioMBS &&
+            lhs.ioSeek == rhs.ioSeek &&
+            lhs.inclusion == rhs.inclusion;
+    }
+
+    bool operator==(const Compression& lhs, const Compression& rhs) {
+        return
+            lhs.codec == rhs.codec &&
+            lhs.termsPerDoc == rhs.termsPerDoc &&
+            lhs.listOverheadBytes == rhs.listOverheadBytes &&
+            lhs.decodeNsPerPosting == rhs.decodeNsPerPosting &&
+            lhs.encodeNsPerPosting == rhs.encodeNsPerPosting;
     }
 
     const std::string& Settings::name(Algorithm alg) {
@@ -5,12 +5,134 @@
 #include <vector>
 #include <cstddef>
 #include <functional>
+#include <string>
+#include <utility>
 
 namespace IndexUpdate {
     enum Algorithm {
         NeverMerge, AlwaysMerge, LogMerge, SkiBased, Prognosticator
     };
     enum DiskType { HD, SSD};
+    enum Codec { Uncompressed, VarByte, BitPacked };
+    //which packs evictTPacks flushes first
+    enum EvictionOrder {
+        LargestIdFirst, //the castes with larger ID
+        BenefitPerIO //most buffered postings freed per minute of flush and query I/O it brings
+    };
+
+    //how the cached postings of a term follow the index once a flush or merge changed them
+    enum CacheCoherence {
+        PatchOnHit, //the next hit takes the new length as is, for free
+        InvalidateStale, //after each eviction, the stale terms of the changed packs are dropped
+        RefreshStale //...or read again (charged as query reads), those that still fit
+    };
+
+    //queue-depth aware device for the simulated I/O timeline
+    struct DeviceModel {
+        bool timeline = false; //off: only the serial cost model (costIoInMinutes)
+        unsigned channels = 1; //independent units serving requests
+        unsigned queueDepth = 1; //at most min(channels, queueDepth) requests are served at once
+        unsigned readMBS = 0; //aggregate over the channels
+        unsigned writeMBS = 0;
+        double readLatency = 0; //ms per request (seek on HD)
+        double writeLatency = 0;
+        uint64_t maxRequestBytes = 8ull << 20; //larger transfers are split into such requests
+        double ingestPostingsPerSec = 1e5; //maps the postings stream onto simulated time
+    };
+
+    //background merges: consolidations queue up and complete later in simulated time,
+    //until then the queries still pay for the segments being merged
+    struct MergeSchedule {
+        bool background = false; //off: every merge completes at its eviction
+        unsigned budgetMBS = 0; //bandwidth the merges may take (0: all of it)
+        double deferAboveQps = 0; //queued merges wait while the query rate is above that (0: never)
+        double maxDeferSec = 600; //...but no longer than that
+    };
+
+    //the memory of the merges and how many run at once (see MergeModel)
+    struct MergeMemory {
+        uint64_t postings = 1ull << 26; //of all the streams, split evenly among them
+        //concurrent merge streams: they share the memory and the device, and on HD the head
+        //(interleaved I/O seeks more); background merges run on that many streams
+        unsigned streams = 1;
+        bool fromCache = false; //the merge memory comes out of cacheSizePostings (one budget for both)
+    };
+
+    //from startSec on (of the simulated clock) the postings arrive at updateRate times
+    //DeviceModel::ingestPostingsPerSec and the queries at queryRate times the rate the quants set
+    struct WorkloadPiece {
+        double startSec = 0;
+        double updateRate = 1;
+        double queryRate = 1;
+        std::vector<std::pair<unsigned, double> > packUpdates; //pack, weight in the update mix (the rest: 1)
+    };
+    //time-varying rates (see WorkloadClock), e.g. a diurnal cycle or a re-index burst
+    struct WorkloadProfile {
+        std::vector<WorkloadPiece> pieces; //by startSec, the first at 0; empty: constant rates
+        double periodSec = 0; //the pieces repeat with that period (0: the last one lasts)
+    };
+
+    //adaptive split of updateBufferPostingsLimit + cacheSizePostings (see MemoryPartition)
+    struct MemoryAdaptation {
+        bool adaptive = false; //off: the split stays as configured
+        unsigned stepPermille = 10; //of the total, moved at a time
+        unsigned minPercent = 5; //either side keeps at least that much of the total
+    };
+
+    //the forecasts of the Prognosticator algorithm
+    struct Prognosis {
+        double smoothing = 0.3; //weight of the latest history in the moving averages
+        double maxHorizonBuffers = 8; //the horizon of a flush is at most that many update buffers of postings
+    };
+
+    //SkiBased merges each pack by the policy that suits its queries-to-updates mix:
+    //the seek minutes of its recent disk queries per minute of merging it fully (rho)
+    struct PackPolicies {
+        unsigned reevaluateEvictions = 0; //0: ski rental for every pack, otherwise chosen again that often
+        double neverBelow = 0.01; //rho below that: NeverMerge, the seeks are cheaper than any merge
+        double logAbove = 1; //rho above that: LogMerge, the pack pays for a full merge each period
+    };
+
+    //a second cache tier (an SSD) between the cache in RAM and the index
+    enum TierInclusion {
+        InclusiveTier, //the misses of the cache fill the tier too (the tier decides by itself)
+        ExclusiveTier //the tier holds what the cache evicted (demotion), a tier hit moves up once the cache takes it (promotion)
+    };
+    struct CacheTier {
+        uint64_t postings = 0; //0: a single tier
+        unsigned ioMBS = 500; //the SSD of Profiles::training
+        double ioSeek = 0.0625;
+        TierInclusion inclusion = ExclusiveTier;
+    };
+
+    //deletes and updates in place (a delete and an append) of indexed postings, see TermPack::addDeletes
+    struct Deletes {
+        double perPosting = 0; //deletes per ingested posting
+        double garbageTrigger = 0; //>0: a pack whose garbage is above that share of its disk postings is compacted
+    };
+
+    //a time series of a run's cumulative costs (see TelemetryWriter)
+    struct Telemetry {
+        std::string prefix; //empty: off, otherwise the files are <prefix>-<run>.tlm
+        uint64_t everyQueries = 0; //a record that often (0: after every eviction)
+    };
+
+    //warm starts: the cache a run ends with is saved, and a later run starts from it (see Caching::MappedSnapshot).
+    //a sharded run saves and loads one file per shard, <prefix>-shard<i>-<run>.ulcs: a shard's cache
+    //holds the terms of its own partition of the documents
+    struct CacheSnapshots {
+        std::string load; //empty: a cold cache, otherwise <load>-<run>.ulcs
+        std::string save; //empty: not saved, otherwise <save>-<run>.ulcs
+    };
+
+    //stored size of the postings (see CompressionModel)
+    struct Compression {
+        Codec codec = Uncompressed; //szOfPostingBytes a posting
+        unsigned termsPerDoc = 200; //distinct terms of a document, sets the docid gaps
+        double listOverheadBytes = 16; //header and skips of a list in a segment
+        double decodeNsPerPosting = 0; //CPU a posting (0: the codec's)
+        double encodeNsPerPosting = 0;
+    };
 
     class Settings {
     public:
@@ -18,6 +140,11 @@ namespace IndexUpdate {
         unsigned ioMBS; //how many MB per second we can read/write
         double ioSeek; //the time to make an average seek (random access latency)
         unsigned szOfPostingBytes; //we use fixed size of postings (in bytes).
+        Compression compression;
+        DeviceModel device;
+        MergeSchedule merging;
+        MergeMemory mergeMemory;
+        WorkloadProfile workload;
 
         //how many postings we are going to accommodate
         uint64_t totalExperimentPostings;
@@ -25,11 +152,47 @@ namespace IndexUpdate {
         uint64_t updateBufferPostingsLimit;
         //the size of cache in postings
         uint64_t cacheSizePostings;
+        CacheTier cacheTier;
+        MemoryAdaptation memory;
+        //cache admission: 0 keeps ghost entries of popular evicted terms,
+        //otherwise a TinyLFU frequency sketch sized for that many terms replaces them
+        uint64_t cacheSketchTerms = 0;
+        CacheCoherence coherence = PatchOnHit;
+        //>0: every segment of a TermPack has a Bloom filter with that many bits per term, so
+        //queries skip most of the segments without the term; the filters take cache memory
+        double filterBitsPerKey = 0;
         //the two quants represent the update-to-query ratio
         uint64_t  updatesQuant; //usually one million
         uint64_t  quieriesQuant;
+        Deletes deletes;
 
         unsigned percentsUBLeft; //after eviction can have as much % UB busy (90 is the default)
+        EvictionOrder evictionOrder = LargestIdFirst;
+        //per-TermPack algorithms: an evicted pack flushes only the room still needed, rounded up to
+        //a multiple of that many postings, the rest stays buffered (0: its whole buffer)
+        uint64_t flushPostings = 0;
+        PackPolicies packPolicies;
+        Prognosis prognosis;
+
+        //0 asks the packs round robin, otherwise each query picks a pack at random
+        //(weighted by tpQueries) from this stream of the counter-based generator
+        uint64_t queryStream = 0;
+        //Monte Carlo: up to that many replicas with independent query streams (0 -- a single run),
+        //stopping once the 95% confidence intervals are within replicaPrecision of the means
+        unsigned replicas = 0;
+        double replicaPrecision = 0.01;
+        //>1: a document-partitioned cluster of that many nodes (see Profiles::shard),
+        //the budgets above are then the cluster's. not with replicas
+        unsigned shards = 0;
+        //>1: the flushes and merges of the packs an eviction picked run on that many threads
+        //(the results do not change)
+        unsigned packThreads = 0;
+
+        Telemetry telemetry;
+        CacheSnapshots snapshots;
+        //the reports end with the memory of the cache, segments and scratch (see MemoryAccounting.h);
+        //the counters are the process', so concurrent runs share them
+        bool reportMemory = false;
 
         unsigned flags[16]; //whatever
 
@@ -44,6 +207,19 @@ namespace IndexUpdate {
     };
 
     bool operator==(const Settings& lhs, const Settings& rhs) ;
+    bool operator==(const DeviceModel& lhs, const DeviceModel& rhs) ;
+    bool operator==(const MergeSchedule& lhs, const MergeSchedule& rhs) ;
+    bool operator==(const MergeMemory& lhs, const MergeMemory& rhs) ;
+    bool operator==(const MemoryAdaptation& lhs, const MemoryAdaptation& rhs) ;
+    bool operator==(const Prognosis& lhs, const Prognosis& rhs) ;
+    bool operator==(const PackPolicies& lhs, const PackPolicies& rhs) ;
+    bool operator==(const Compression& lhs, const Compression& rhs) ;
+    bool operator==(const CacheTier& lhs, const CacheTier& rhs) ;
+    bool operator==(const Deletes& lhs, const Deletes& rhs) ;
+    bool operator==(const Telemetry& lhs, const Telemetry& rhs) ;
+    bool operator==(const CacheSnapshots& lhs, const CacheSnapshots& rhs) ;
+    bool operator==(const WorkloadPiece& lhs, const WorkloadPiece& rhs) ;
+    bool operator==(const WorkloadProfile& lhs, const WorkloadProfile& rhs) ;
 }
 
 namespace std {
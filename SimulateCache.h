@@ -0,0 +1,162 @@
+#ifndef UPDATE_LITE_SIMULATECACHE_H
+#define UPDATE_LITE_SIMULATECACHE_H
+
+#include "Settings.h"
+#include "TermPack.h"
+#include "Caching.h"
+#include "CacheSnapshot.h"
+#include "Compression.h"
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+namespace IndexUpdate {
+
+    //maps the queries of a TermPack onto its terms (round robin over the members) and visits the cache,
+    //then its misses visit the second tier (settings.cacheTier), if there is one
+    template<typename CachePolicy>
+    struct SimulateCache {
+        CachePolicy cache;
+        CachePolicy tier;
+        const bool tiered;
+        const bool exclusive;
+        std::vector<std::pair<unsigned, unsigned> > termRanges;
+        std::vector<unsigned> currentPostions;
+        const CompressionModel* compression = nullptr; //if enabled, a term takes its stored words
+        std::vector<Caching::TermVisit> victims; //of the cache, to be demoted (exclusive tier)
+        uint64_t demotedPostings = 0;
+
+        //coherence (settings.coherence): what cohere found and did
+        size_t staleTerms = 0;
+        size_t refreshedTerms = 0;
+        size_t invalidatedTerms = 0;
+        ReadIO refreshReads; //charged as query reads
+
+        explicit SimulateCache(const Settings& s):
+                cache(s.cacheSizePostings), tier(s.cacheTier.postings),
+                tiered(s.cacheTier.postings), exclusive(s.cacheTier.inclusion == ExclusiveTier) {
+            cache.useFrequencySketch(s.cacheSketchTerms);
+            if(tiered && exclusive) {
+                cache.collectVictims(&victims);
+                tier.admitOnMiss(false);
+            }
+        }
+
+        void init(const std::vector<TermPack>& tpacks) {
+            unsigned first = 0;
+            currentPostions.resize(tpacks.size(),0);
+            for(auto it = tpacks.begin(); it != tpacks.end(); ++it) {
+                termRanges.push_back({first,first+it->members()});
+                first = termRanges.back().second+1;
+            }
+        }
+
+        unsigned nextTerm(unsigned id) {
+            auto range = termRanges[id];
+            auto term = range.first + currentPostions[id];
+            currentPostions[id] = (currentPostions[id]+1) % (range.second-range.first);
+            return term;
+        }
+
+        bool visit(unsigned id, uint64_t currentLength) {
+            return cache.visit(nextTerm(id),currentLength);
+        }
+
+        std::vector<Caching::TermVisit> batch;
+        Caching::BatchResult batchResult;
+        std::vector<char> tierHits; //tierHits[i]: the i-th visit of the batch missed the cache, the tier served it
+
+        //what a term of the pack takes in the cache: its live postings only
+        uint64_t lengthOf(const std::vector<TermPack>& tpacks, unsigned id) const {
+            const auto& tp = tpacks[id];
+            return compression && compression->enabled() ?
+                   compression->storedWords(int(id), tp.liveDiskLength(), tp.segments().size()) :
+                   tp.liveDiskLength();
+        }
+
+        unsigned packOf(unsigned term) const {
+            auto it = std::upper_bound(termRanges.begin(), termRanges.end(), term,
+                                       [](unsigned t, const std::pair<unsigned, unsigned>& range) {
+                                           return t < range.first;
+                                       });
+            return unsigned(it - termRanges.begin()) - 1;
+        }
+
+        //the packs with changed[id] set were flushed or merged: their cached terms (in both tiers)
+        //are read again from the index (refresh) or dropped, in one pass over each cache
+        void cohere(const std::vector<TermPack>& tpacks, const std::vector<char>& changed, bool refresh) {
+            auto currentLength = [&](Caching::term_t term, size_t cached) -> size_t {
+                const auto id = packOf(term);
+                return changed[id] ? size_t(lengthOf(tpacks, id)) : cached;
+            };
+            auto staleTerm = [this](size_t cached, size_t current, bool refreshed) {
+                if(!refreshed) {
+                    ++invalidatedTerms;
+                    return;
+                }
+                ++refreshedTerms;
+                //an append reads the new tail (in the newest segment), a merge the whole list
+                refreshReads += ReadIO(current > cached ? current - cached : current, 1);
+            };
+            staleTerms += cache.cohere(currentLength, refresh, staleTerm);
+            if(tiered)
+                staleTerms += tier.cohere(currentLength, refresh, staleTerm);
+        }
+
+        //one query per pack id; the outcome is in batchResult
+        void visitBatch(const std::vector<TermPack>& tpacks, const std::vector<unsigned>& packIds) {
+            batch.clear();
+            for(auto id : packIds)
+                batch.push_back(Caching::TermVisit(nextTerm(id), lengthOf(tpacks, id)));
+            cache.visitBatch(batch.data(), batch.data()+batch.size(), batchResult);
+            if(tiered)
+                visitTier();
+        }
+
+        //the victims of the batch go down first, then the misses of the batch visit the tier in order
+        void visitTier() {
+            for(const auto& victim : victims) {
+                tier.insert(victim.first, victim.second);
+                demotedPostings += victim.second;
+            }
+            victims.clear();
+            tierHits.assign(batch.size(), 0);
+            for(size_t i = 0; i < batch.size(); ++i) {
+                if(batchResult.hits[i] || !tier.visit(batch[i].first, batch[i].second))
+                    continue;
+                tierHits[i] = 1;
+                if(exclusive && cache.contains(batch[i].first)) //promoted
+                    tier.drop(batch[i].first);
+            }
+        }
+
+        bool tierHit(size_t i) const { return tiered && tierHits[i]; }
+
+        //the cache (not the tier) and where the packs' queries are in their members
+        void save(const std::string& path) const {
+            std::vector<Caching::SnapshotEntry> entries;
+            const auto clock = cache.save(entries);
+            Caching::writeSnapshot(path, clock, entries, currentPostions);
+        }
+        //into a cold cache, after init; throws std::runtime_error on a snapshot of other packs
+        void load(const std::string& path) {
+            Caching::MappedSnapshot snapshot(path);
+            if(snapshot.header().cursors != currentPostions.size())
+                throw std::runtime_error("the cache snapshot " + path + " has other term packs");
+            cache.load(snapshot.begin(), snapshot.end(), snapshot.header().accumulator);
+            currentPostions.assign(snapshot.cursors(), snapshot.cursors() + snapshot.header().cursors);
+        }
+
+        void report(std::ostream& out, unsigned totalQs) const {
+            cache.report(out, totalQs, !tiered);
+            if(!tiered)
+                return;
+            out << " ssd-tier: ";
+            tier.report(out, totalQs);
+        }
+    };
+}
+
+#endif //UPDATE_LITE_SIMULATECACHE_H
@@ -2,47 +2,112 @@
 #include "Settings.h"
 #include "TermPack.h"
 #include "Landlord.h"
+#include "SimulateCache.h"
+#include "SkiRental.h"
+#include "IOTimeline.h"
+#include "MergeScheduler.h"
+#include "Workload.h"
+#include "Telemetry.h"
+#include "MemoryAccounting.h"
+#include "Histogram.h"
+#include "MemoryPartition.h"
+#include "Compression.h"
+#include "Forecaster.h"
+#include "PriorityIndex.h"
+#include "Random.h"
+#include "Statistics.h"
+#include "ThreadPool.h"
+#include "Profiles.h"
 
 #include <iostream>
+#include <algorithm>
+#include <numeric>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
+#include <limits>
+#include <type_traits>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <memory>
+#include <functional>
 
 namespace IndexUpdate {
 
-    void auxRebuildCPrice(std::vector<double> &consolidationPriceVector, const std::vector<size_t>& sizeStack,
-                          const Settings &settings, double stopForTokens);
+    const uint64_t queryBatchSize = 1024;
 
-    struct SimulateCache {
-        Caching::Landlord cache;
-        std::vector<std::pair<unsigned, unsigned> > termRanges;
-        std::vector<unsigned> currentPostions;
+    namespace {
+        //the tail of h, its values over scale (1: as counts)
+        void printTails(std::ostream& out, const Histogram& h, double scale = 1.0) {
+            const char* names[] = {" p50: ", " p90: ", " p99: ", " p999: ", " max: "};
+            const uint64_t values[] = {h.percentile(0.5), h.percentile(0.9), h.percentile(0.99),
+                                       h.percentile(0.999), h.max()};
+            for(size_t i = 0; i < 5; ++i) {
+                out << names[i];
+                if(scale == 1.0)
+                    out << values[i];
+                else
+                    out << double(values[i]) / scale;
+            }
+        }
 
-        explicit SimulateCache(uint64_t cacheSz):
-                cache(cacheSz) {}
+        //the distributions over the queries of a run (merged over replicas or shards)
+        struct QueryTails {
+            Histogram seeks; //index seeks a query made, 0 for a cache (or tier) hit
+            Histogram postings; //postings it read from the index
+            Histogram latencyUs;
 
-        void init(const std::vector<TermPack>& tpacks) {
-            unsigned first = 0;
-            currentPostions.resize(tpacks.size(),0);
-            for(auto it = tpacks.begin(); it != tpacks.end(); ++it) {
-                termRanges.push_back({first,first+it->members()});
-                first = termRanges.back().second+1;
+            void merge(const QueryTails& other) {
+                seeks.merge(other.seeks);
+                postings.merge(other.postings);
+                latencyUs.merge(other.latencyUs);
             }
-        }
+            void report(std::ostream& out, bool latency = true) const {
+                out << " Query-seeks:";
+                printTails(out, seeks);
+                out << " Query-postings:";
+                printTails(out, postings);
+                if(latency) {
+                    out << " Query-latency-ms:";
+                    printTails(out, latencyUs, 1000.0);
+                }
+            }
+        };
 
-        bool visit(unsigned id, uint64_t currentLength) {
-            auto range = termRanges[id];
-            auto term = range.first + currentPostions[id];
-            currentPostions[id] = (currentPostions[id]+1) % (range.second-range.first);
-            return cache.visit(term,currentLength);
+        //the settings a simulation runs with: the cache gives up the merge memory if they share a budget
+        Settings withMergeMemory(Settings s) {
+            if(s.mergeMemory.fromCache)
+                s.cacheSizePostings -= std::min(s.cacheSizePostings, s.mergeMemory.postings);
+            return s;
         }
+    }
+
+    //per-eviction behaviour of an algorithm: flushes TermPacks one by one, or the whole buffer
+    inline constexpr bool perTermPack(Algorithm alg) { return alg == SkiBased || alg == Prognosticator; }
+
+    //the algorithm of a SimulatorIMP: a value known at run time...
+    struct RuntimeAlgorithm {
+        Algorithm value;
+        explicit RuntimeAlgorithm(Algorithm a = SkiBased) : value(a) {}
+        Algorithm operator()() const { return value; }
+    };
+
+    //...or a compile-time constant, so every branch on it folds away (Simulator::simulateSpecialized)
+    template<Algorithm Alg>
+    struct StaticAlgorithm {
+        constexpr Algorithm operator()() const { return Alg; }
     };
 
+    template<typename AlgPolicy, typename CachePolicy>
     class SimulatorIMP {
+        const AlgPolicy alg;
         const Settings settings;
 
         uint64_t totalSeenPostings;
         uint64_t postingsInUpdateBuffer;
+        uint64_t tombstonesInUpdateBuffer; //they take room too (settings.deletes)
+        uint64_t updateBufferLimit; //settings.updateBufferPostingsLimit, unless the memory split adapts
         uint64_t lastQueryAtPostings;
         unsigned  queriesStoppedAt;
 
@@ -50,113 +115,457 @@ namespace IndexUpdate {
         unsigned evictions;
 
         ReadIO totalQueryReads;
+        ReadIO tierReads; //served by the second cache tier (settings.cacheTier)
 
         ConsolidationStats merges;
         std::vector<TermPack> tpacks;
-        std::vector<uint64_t> monolithicSegments;
-        SimulateCache cache;
+        SegmentStack monolithicSegments;
+        SimulateCache<CachePolicy> cache;
+
+        CounterRNG queryRng; //used only when settings.queryStream is set
+        DiscreteSampler queryPacks;
+        std::vector<unsigned> batchPacks;
+
+        IOTimeline device; //enabled by settings.device.timeline
+        MergeScheduler mergeStream; //enabled by settings.merging.background
+        double queryRateQps;
+        WorkloadClock workload; //settings.workload, constant rates without it
+        double queryCarry; //the fraction of a query the profile asked for
+        std::vector<double> pieceMergeMinutes; //by the piece of the profile the merges start in
+        std::unique_ptr<TelemetryWriter> telemetry; //settings.telemetry
+        uint64_t nextSampleAt; //queries, with settings.telemetry.everyQueries
+        void sample(uint64_t queries); //of them asked so far
+        //<prefix>-<algorithm>-<disk>-<flags>, the files of this run
+        std::string runFile(const std::string& prefix, const char* extension) const;
+        size_t warmTerms; //of the cache the run started with (settings.snapshots)
+        uint64_t warmPostings;
+        QueryTails tails; //per query, recorded as they are asked
+        std::vector<double>* latencySink; //every query's latency in ms goes there too, if set
+
+        //the packs by evictionBenefit (BenefitPerIO order); only the packs that changed
+        //since the last eviction are re-keyed
+        PriorityIndex evictionIndex;
+        std::vector<char> benefitStale;
+        std::vector<unsigned> stalePacks;
+        std::vector<uint64_t> queriesAtFlush;
+        std::vector<uint64_t> postingsAtFlush;
+
+        void touched(unsigned pack) {
+            if(!benefitStale[pack]) {
+                benefitStale[pack] = 1;
+                stalePacks.push_back(pack);
+            }
+        }
+        double evictionBenefit(const TermPack& tp) const;
+
+        //the merge policy of each pack: NeverMerge, LogMerge or SkiBased (settings.packPolicies)
+        std::vector<Algorithm> packPolicy;
+        std::vector<uint64_t> queriesAtChoice;
+        unsigned policySwitches;
+        void choosePackPolicies();
+
+        //the packs an eviction flushes, in order; their merges are independent of each other
+        struct PackEviction {
+            unsigned pack;
+            int offset; //<0: as the pack's policy decides
+            uint64_t limit; //of the postings it flushes (see flushLimit)
+            uint64_t postings;
+            uint64_t tombstones;
+            size_t segmentsBefore;
+            ConsolidationStats cost;
+            explicit PackEviction(unsigned p, int off = -1, uint64_t lim = UINT64_MAX) :
+                    pack(p), offset(off), limit(lim), postings(0), tombstones(0), segmentsBefore(0) {}
+        };
+        std::vector<PackEviction> victims;
+        //the packs flushed or merged since the last cohere (settings.coherence)
+        std::vector<char> packChanged;
+        void cohere();
+        //the postings a pack flushes to free room of the buffer (settings.flushPostings)
+        uint64_t flushLimit(uint64_t room) const;
+        uint64_t partialFlushes; //that left postings in the buffer
+        std::vector<PriceScratch> packScratch; //consolidation prices, per pack
+        std::unique_ptr<ThreadPool> packPool; //settings.packThreads > 1
+        //flushes and consolidates a victim; touches its pack (and its scratch) only
+        void consolidateVictim(PackEviction& victim);
+        //charges the simulator for a consolidated victim
+        void settleVictim(const PackEviction& victim);
+        //consolidateVictim over the victims (in parallel if there is a pool), then
+        //settleVictim in their order, so the totals do not depend on the threads
+        void evictVictims();
+
+        Forecaster forecaster; //the Prognosticator algorithm only
+        std::vector<Forecaster::Plan> plans;
+
+        //segment filters (settings.filterBitsPerKey, per-TermPack algorithms)
+        bool filters;
+        uint64_t filterPostings; //their memory, taken from the cache
+        uint64_t peakFilterPostings;
+        int64_t skippedProbes;
+        void chargeFilters();
+
+        CompressionModel compression; //enabled by settings.compression.codec
+        uint64_t queryPostingsDecoded;
+        ConsolidationStats rawMerges; //in postings, merges has the stored words
+
+        MemoryPartition memory; //enabled by settings.memory.adaptive
+        uint64_t partitionedAtPostings;
+        size_t shadowHitsSeen;
+        size_t shadowPostingsSeen;
+        size_t hitsSeen;
+        size_t servedSeen;
+        ReadIO queryReadsSeen;
+        uint64_t queriesSeen;
     public:
-        SimulatorIMP(const Settings &s);
+        explicit SimulatorIMP(const Settings &s, AlgPolicy a = AlgPolicy());
 
         ~SimulatorIMP() { }
 
-        const SimulatorIMP& execute(Algorithm alg);
+        const SimulatorIMP& execute();
         void init();
+        //runs until the postings stream reaches untilMs on the simulated clock; false once finished
+        bool advance(double untilMs);
+        //completes the background work after the last eviction
+        void finish();
+        void collectLatencies(std::vector<double>* sink) { latencySink = sink; }
         bool finished() const;
         bool bufferFull() const;
+        uint64_t bufferLoad() const { return postingsInUpdateBuffer + tombstonesInUpdateBuffer; }
         void handleQueries();
-        void fillUpdateBuffer();
-        void evictFromUpdateBuffer(Algorithm alg);
-        void evictMonoliths(Algorithm alg);
-        void evictTPacks(Algorithm alg);
-
-        ConsolidationStats consolidateTPSki(TermPack& tp) {
-            auto segments = tp.segments();
-            ConsolidationStats nil;
-            if(segments.size()<2) {
-                nil += WriteIO(segments.back(), 0); //0 since we write all non-consolidants together
-                return nil;
-            }
+        void fillUpdateBuffer(uint64_t untilPostings = std::numeric_limits<uint64_t>::max());
+        void evictFromUpdateBuffer();
+        void evictMonoliths();
+        void evictTPacks();
+        void evictForecast();
+        void evictByBenefit();
+        //flushes tp (enough of it for room postings, see flushLimit) and consolidates it
+        //as its pack policy (by default the ski rental) decides
+        void evictSki(TermPack& tp, uint64_t room);
 
-            double tokens = tp.convertSeeksToTokens( //exchange seeks for tokens
-                                 costIoInMinutes(ReadIO(0,tp.extraSeeks()),
-                                    settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes));
-
-            std::vector<double> consolidationPriceVector;
-            auxRebuildCPrice(consolidationPriceVector, segments, settings,tokens);
-
-            auto i = int(consolidationPriceVector.size()-1);
-            while(i>=0 && tokens >= consolidationPriceVector[size_t(i)])
-                --i;
-            unsigned offset = i+1;
-
-            assert(offset<=segments.size());
-            if(offset<segments.size()-1) {
-                auto cons = consolidateSegments(tp.unsafeGetSegments(), offset);
-                tp.reduceTokens(ConsolidationStats::costInMinutes(cons,
-                                                settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes));
-                return cons;
-            }
-
-            nil += WriteIO(segments.back(),0); //0 since we write all non-consolidants together
-            return nil;
+        double nowMs() const {
+            return workload.postingsToMs(totalSeenPostings + postingsInUpdateBuffer);
+        }
+        //segmentsBefore -> segmentsAfter of packId (-1: all the packs) cost that much
+        void merged(int packId, uint64_t segmentsBefore, uint64_t segmentsAfter, const ConsolidationStats& cost);
+        void advanceMerges(double atMs);
+        //moves memory between the update buffer and the cache after an eviction that cost that much
+        void repartition(const ConsolidationStats& cost);
+        void unmergedSegments(int packId, int delta) {
+            if(packId >= 0)
+                tpacks[packId].addUnmerged(delta);
+            else
+                for(auto& tp : tpacks)
+                    tp.addUnmerged(delta);
         }
 
         ConsolidationStats consolidateTPStatic(TermPack& tp) {
-            auto &segments = tp.unsafeGetSegments();
-            auto offset = offsetOfTelescopicMerge(segments);
-            assert(offset<=monolithicSegments.size());
-            if(offset<monolithicSegments.size()-1)
-                return consolidateSegments(segments, offset);
-
-            ConsolidationStats nil;
-            nil += WriteIO(segments.back(),1);
-            return nil;
+            return consolidateTP(tp, offsetOfTelescopicMerge(tp.segments()), settings);
         }
 
-        std::string report(Algorithm alg) const;
+        std::string report() const;
+        const QueryTails& queryTails() const { return tails; }
 
         double getTotalQTime() const;
+        double hitPct() const { return totalQs ? double(cache.cache.cacheHits) / double(totalQs) * 100.0 : 0.0; }
         double allTimes() const;
         double getMergeTimes() const;
     };
 
+    //the engine of the simulations; Benchmark.cpp measures it against the specialized one
+    typedef SimulatorIMP<RuntimeAlgorithm, Caching::Landlord> Engine;
+
+    struct RunResult {
+        std::string report;
+        double queryMinutes;
+        double mergeMinutes;
+        double hitPct;
+        QueryTails tails;
+
+        double allTimes() const { return queryMinutes + mergeMinutes; }
+    };
+
+    template<typename AlgPolicy, typename CachePolicy>
+    RunResult runOne(const Settings &settings, AlgPolicy alg = AlgPolicy()) {
+        SimulatorIMP<AlgPolicy, CachePolicy> sim(settings, alg);
+        sim.execute();
+        RunResult result;
+        result.report = sim.report();
+        result.queryMinutes = sim.getTotalQTime();
+        result.mergeMinutes = sim.getMergeTimes();
+        result.hitPct = sim.hitPct();
+        result.tails = sim.queryTails();
+        return result;
+    }
+
+    RunResult run(Algorithm alg, const Settings &settings) {
+        return runOne<RuntimeAlgorithm, Caching::Landlord>(settings, RuntimeAlgorithm(alg));
+    }
+
+    //maps the algorithm to its compiled specialization
+    RunResult runSpecialized(Algorithm alg, const Settings &settings) {
+        typedef Caching::StaticLandlord Cache;
+        switch(alg) {
+            case NeverMerge:     return runOne<StaticAlgorithm<NeverMerge>, Cache>(settings);
+            case AlwaysMerge:    return runOne<StaticAlgorithm<AlwaysMerge>, Cache>(settings);
+            case LogMerge:       return runOne<StaticAlgorithm<LogMerge>, Cache>(settings);
+            case SkiBased:       return runOne<StaticAlgorithm<SkiBased>, Cache>(settings);
+            case Prognosticator: return runOne<StaticAlgorithm<Prognosticator>, Cache>(settings);
+        }
+        assert(false);
+        return RunResult();
+    }
+
     double Simulator::simulateOne(Algorithm alg, const Settings & settings) {
-        return SimulatorIMP(settings).execute(alg).allTimes();
+        return run(alg, settings).allTimes();
+    }
+
+    double Simulator::simulateSpecialized(Algorithm alg, const Settings & settings) {
+        return runSpecialized(alg, settings).allTimes();
     }
 
     std::vector<std::string> Simulator::simulate(const std::vector<Algorithm>& algs, const Settings &settings) {
+        if(settings.shards > 1 && settings.replicas)
+            throw std::invalid_argument("a sharded run has no replicas (shards and replicas are exclusive)");
+        if(settings.shards > 1) {
+            std::vector<std::string> reports;
+            std::vector<Settings> nodes(settings.shards, Profiles::shard(settings, settings.shards));
+            for(auto alg : algs)
+                reports.emplace_back(simulateSharded(alg, nodes));
+            return reports;
+        }
+        if(settings.replicas)
+            return replicate(algs, settings);
         //auto start = std::chrono::system_clock::now();
         std::vector<std::string> reports;
         for(auto alg : algs)
-            reports.emplace_back(
-                    SimulatorIMP(settings).execute(alg).report(alg));
+            reports.emplace_back(run(alg, settings).report);
 
         //auto end = std::chrono::system_clock::now();
         //std::cerr << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms\n";
         return reports;
     }
 
-    SimulatorIMP::SimulatorIMP(const Settings &s) :
-            settings(s),
+    namespace {
+        struct ReplicaStats {
+            RunningStat queryMinutes;
+            RunningStat mergeMinutes;
+            RunningStat hitPct;
+            QueryTails tails; //the queries of all the replicas
+
+            void add(const RunResult& r) {
+                queryMinutes.add(r.queryMinutes);
+                mergeMinutes.add(r.mergeMinutes);
+                hitPct.add(r.hitPct);
+                tails.merge(r.tails);
+            }
+            bool tight(double relPrecision) const {
+                return queryMinutes.tight(relPrecision) && mergeMinutes.tight(relPrecision) &&
+                       hitPct.tight(relPrecision);
+            }
+        };
+
+        std::ostream& operator<<(std::ostream& out, const RunningStat& stat) {
+            return out << stat.mean() << " +- " << stat.halfWidth95();
+        }
+    }
+
+    std::vector<std::string> Simulator::replicate(const std::vector<Algorithm>& algs, const Settings &settings) {
+        const unsigned minReplicas = 3; //anything less gives no usable variance
+        const unsigned wave = std::max(minReplicas, std::thread::hardware_concurrency());
+        const uint64_t firstStream = settings.queryStream ? settings.queryStream : 1;
+
+        std::vector<std::string> reports;
+        for(auto alg : algs) {
+            ReplicaStats stats;
+            std::string firstReport;
+            unsigned started = 0;
+            //sequential stopping: run waves of replicas until the intervals are tight enough
+            while(started < settings.replicas &&
+                    (stats.queryMinutes.count() < minReplicas || !stats.tight(settings.replicaPrecision))) {
+                std::vector<std::future<RunResult> > replicas;
+                for(unsigned i = 0; i < wave && started < settings.replicas; ++i, ++started) {
+                    Settings replica(settings);
+                    replica.queryStream = firstStream + started;
+                    if(started) { //the first replica's telemetry and snapshot only
+                        replica.telemetry.prefix.clear();
+                        replica.snapshots.save.clear();
+                    }
+                    replicas.emplace_back(std::async(std::launch::async,
+                                                     run, alg, replica));
+                }
+                for(auto& f : replicas) { //collect in replica order, so the stats don't depend on timing
+                    auto r = f.get();
+                    if(firstReport.empty())
+                        firstReport = r.report;
+                    stats.add(r);
+                }
+            }
+            std::stringstream strstr;
+            strstr << firstReport.substr(0, firstReport.find(" Evictions:")) <<
+                   " Replicas: " << stats.queryMinutes.count() <<
+                   " Total-query-minutes: " << stats.queryMinutes <<
+                   " Total-merge-minutes: " << stats.mergeMinutes <<
+                   " hit-pct: " << stats.hitPct <<
+                   (stats.tight(settings.replicaPrecision) ? "" : " (not converged)");
+            stats.tails.report(strstr);
+            strstr << std::endl;
+            reports.emplace_back(strstr.str());
+        }
+        return reports;
+    }
+
+    namespace {
+        //matches the answers of the shards to the same query: the i-th query of every shard
+        //(they all see the same stream) completes with the slowest of them
+        class QueryRouter {
+            std::vector<std::vector<double> > answers; //per shard, latencies in ms not routed yet
+            std::vector<uint64_t> slowest; //queries a shard was the last to answer
+            Histogram latencyUs;
+            double totalMs;
+        public:
+            explicit QueryRouter(size_t shards) : answers(shards), slowest(shards, 0), totalMs(0) {}
+
+            std::vector<double>* sink(size_t shard) { return &answers[shard]; }
+
+            void route() {
+                size_t ready = answers[0].size();
+                for(const auto& a : answers)
+                    ready = std::min(ready, a.size());
+                for(size_t q = 0; q < ready; ++q) {
+                    size_t worst = 0;
+                    double fastest = answers[0][q];
+                    for(size_t s = 1; s < answers.size(); ++s) {
+                        if(answers[s][q] > answers[worst][q])
+                            worst = s;
+                        fastest = std::min(fastest, answers[s][q]);
+                    }
+                    const double ms = answers[worst][q];
+                    if(ms > fastest) //ties have no straggler
+                        ++slowest[worst];
+                    totalMs += ms;
+                    latencyUs.record(uint64_t(ms * 1000.0));
+                }
+                for(auto& a : answers)
+                    a.erase(a.begin(), a.begin() + ready);
+            }
+
+            void report(std::ostream& out) const {
+                size_t worst = 0;
+                for(size_t s = 1; s < slowest.size(); ++s)
+                    if(slowest[s] > slowest[worst])
+                        worst = s;
+                const uint64_t routed = latencyUs.count();
+                out << " Cluster-query-minutes: " << totalMs / 60000.0 << " Query-latency-ms:";
+                printTails(out, latencyUs, 1000.0);
+                out << " Slowest-shard: " << worst << " slowest-pct: " <<
+                    (routed ? double(slowest[worst]) / double(routed) * 100.0 : 0.0);
+            }
+        };
+    }
+
+    std::string Simulator::simulateSharded(Algorithm alg, const std::vector<Settings>& shards) {
+        assert(!shards.empty());
+        const size_t n = shards.size();
+        QueryRouter router(n);
+        std::vector<std::unique_ptr<Engine> > engines;
+        std::atomic<bool> failed(false);
+        //a shard's error is reported and fails the run (and the pool's jobs must not throw)
+        auto onShard = [&failed](size_t i, const std::function<void()>& step) {
+            try {
+                step();
+            }
+            catch (std::exception &e) {
+                std::cerr << "Error: shard " << i << ": " << e.what() << std::endl;
+                failed = true;
+            }
+        };
+        for(size_t i = 0; i < n && !failed; ++i) {
+            Settings node(shards[i]);
+            if(i) //shard 0's telemetry only
+                node.telemetry.prefix.clear();
+            //every shard saves and loads its own cache (see CacheSnapshots)
+            for(auto prefix : {&node.snapshots.load, &node.snapshots.save})
+                if(!prefix->empty())
+                    *prefix += "-shard" + std::to_string(i);
+            engines.emplace_back(new Engine(node, RuntimeAlgorithm(alg)));
+            engines.back()->collectLatencies(router.sink(i));
+            onShard(i, [&engines]() { engines.back()->init(); });
+        }
+        if(failed)
+            return std::string();
+        ThreadPool pool(std::min<unsigned>(std::thread::hardware_concurrency(), unsigned(n)));
+        std::vector<char> running(n, 1);
+
+        //the global clock moves in epochs of about an eighth of a node's update buffer
+        const double epochMs = IOTimeline::postingsToMs(shards[0].updateBufferPostingsLimit / 8, shards[0].device);
+        for(double clock = epochMs; !failed; clock += epochMs) {
+            pool.parallelFor(n, [&](size_t i) {
+                onShard(i, [&]() { running[i] = engines[i]->advance(clock); });
+            });
+            router.route();
+            if(std::find(running.begin(), running.end(), 1) == running.end())
+                break;
+        }
+        if(!failed)
+            pool.parallelFor(n, [&](size_t i) { onShard(i, [&]() { engines[i]->finish(); }); });
+        if(failed) //no report of a partial run
+            return std::string();
+
+        double queryMinutes = 0, mergeMinutes = 0, slowestMerge = 0;
+        QueryTails shardTails; //a query's reads on a shard (its latency is the router's)
+        for(const auto& e : engines) {
+            shardTails.merge(e->queryTails());
+            queryMinutes += e->getTotalQTime();
+            mergeMinutes += e->getMergeTimes();
+            slowestMerge = std::max(slowestMerge, e->getMergeTimes());
+        }
+        const Settings& first = shards[0];
+        std::stringstream strstr;
+        strstr << Settings::name(alg) << " " << (first.diskType==HD?"HD":"SSD") <<
+               " " << first.flags[0] << "--" << first.flags[1] <<
+               " Shards: " << n <<
+               " Shard-query-minutes: " << queryMinutes / double(n) <<
+               " Total-merge-minutes: " << mergeMinutes <<
+               " Slowest-shard-merge-minutes: " << slowestMerge;
+        router.report(strstr);
+        shardTails.report(strstr, false);
+        strstr << std::endl;
+        for(size_t i = 0; i < n; ++i)
+            strstr << "  shard " << i << ": " << engines[i]->report();
+        return strstr.str();
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    SimulatorIMP<AlgPolicy, CachePolicy>::SimulatorIMP(const Settings &s, AlgPolicy a) :
+            alg(a),
+            settings(withMergeMemory(s)),
             totalSeenPostings(0),
             postingsInUpdateBuffer(0),
+            updateBufferLimit(s.updateBufferPostingsLimit),
             lastQueryAtPostings(0),
             queriesStoppedAt(0),
             totalQs(0),
             evictions(0),
-            cache(s.cacheSizePostings)
+            cache(settings),
+            queryRateQps(0),
+            queryCarry(0),
+            nextSampleAt(0),
+            warmTerms(0),
+            warmPostings(0),
+            latencySink(nullptr),
+            partitionedAtPostings(0),
+            shadowHitsSeen(0),
+            shadowPostingsSeen(0),
+            hitsSeen(0),
+            servedSeen(0),
+            queriesSeen(0)
             {    }
 
-    const SimulatorIMP&  SimulatorIMP::execute(Algorithm alg) {
+    template<typename AlgPolicy, typename CachePolicy>
+    const SimulatorIMP<AlgPolicy, CachePolicy>&  SimulatorIMP<AlgPolicy, CachePolicy>::execute() {
         try {
             init();
-            while (!finished()) {
-                fillUpdateBuffer();
-                handleQueries();
-                evictFromUpdateBuffer(alg);
-                //std::cout << totalSeenPostings << "\n";
-            }
+            advance(std::numeric_limits<double>::infinity());
+            finish();
         }
         catch (std::exception &e) {
             std::cerr << "Error: " << e.what() << std::endl;
@@ -164,19 +573,71 @@ namespace IndexUpdate {
         return *this;
     }
 
+    template<typename AlgPolicy, typename CachePolicy>
+    bool SimulatorIMP<AlgPolicy, CachePolicy>::advance(double untilMs) {
+        const double until = workload.msToPostings(untilMs);
+        const uint64_t untilPostings = until < double(std::numeric_limits<uint64_t>::max()) ?
+                                       uint64_t(until) : std::numeric_limits<uint64_t>::max();
+        while (!finished() && totalSeenPostings + postingsInUpdateBuffer < untilPostings) {
+            fillUpdateBuffer(untilPostings);
+            handleQueries();
+            if(bufferFull() || finished())
+                evictFromUpdateBuffer();
+            //std::cout << totalSeenPostings << "\n";
+        }
+        return !finished();
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::finish() {
+        if(mergeStream.enabled())
+            advanceMerges(std::numeric_limits<double>::infinity());
+        if(device.enabled())
+            device.drain();
+        if(telemetry) //the totals of the report
+            sample(totalQs);
+        if(!settings.snapshots.save.empty())
+            cache.save(runFile(settings.snapshots.save, ".ulcs"));
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    std::string SimulatorIMP<AlgPolicy, CachePolicy>::runFile(const std::string& prefix, const char* extension) const {
+        std::stringstream name;
+        name << prefix << '-' << Settings::name(alg()) << '-' << (settings.diskType==HD?"HD":"SSD") <<
+             '-' << settings.flags[0] << '-' << settings.flags[1] << extension;
+        return name.str();
+    }
+
 
-    void SimulatorIMP::init() {
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::init() {
         assert(settings.updatesQuant > 9999); //no point to make it too small
         assert(settings.totalExperimentPostings * settings.quieriesQuant);
         assert(settings.updateBufferPostingsLimit > settings.updatesQuant);
         assert(settings.tpQueries.size() == settings.tpUpdates.size());
         assert(settings.tpQueries.size() == settings.tpMembers.size());
+        device.init(settings.device, settings.szOfPostingBytes);
+        mergeStream.init(settings);
+        tails = QueryTails();
+        queryRateQps = 0;
+        workload.init(settings);
+        queryCarry = 0;
+        pieceMergeMinutes.assign(workload.size(), 0);
+        nextSampleAt = settings.telemetry.everyQueries;
+        if(!settings.telemetry.prefix.empty())
+            telemetry.reset(new TelemetryWriter(runFile(settings.telemetry.prefix, ".tlm")));
+        updateBufferLimit = settings.updateBufferPostingsLimit;
+        memory.init(settings);
+        partitionedAtPostings = shadowHitsSeen = shadowPostingsSeen = hitsSeen = servedSeen = queriesSeen = 0;
+        queryReadsSeen = ReadIO();
+        if(memory.enabled())
+            cache.cache.setShadowPostings(memory.step());
 
-        totalSeenPostings = postingsInUpdateBuffer =
+        totalSeenPostings = postingsInUpdateBuffer = tombstonesInUpdateBuffer =
         evictions = totalQs =
         queriesStoppedAt = lastQueryAtPostings = 0;
 
-        totalQueryReads = ReadIO();
+        totalQueryReads = tierReads = ReadIO();
         auto updates = settings.tpUpdates.begin();
         auto queries = settings.tpQueries.begin();
         auto members = settings.tpMembers.begin();
@@ -189,17 +650,54 @@ namespace IndexUpdate {
         }
         TermPack::normalizeUpdates(tpacks);
         cache.init(tpacks);
+        compression.init(settings);
+        cache.compression = &compression;
+        queryPostingsDecoded = 0;
+        rawMerges = ConsolidationStats();
+        if(alg() == Prognosticator)
+            forecaster.init(settings, tpacks);
+        evictionIndex.reset(tpacks.size());
+        benefitStale.assign(tpacks.size(), 0);
+        stalePacks.clear();
+        queriesAtFlush.assign(tpacks.size(), 0);
+        postingsAtFlush.assign(tpacks.size(), 0);
+        packPolicy.assign(tpacks.size(), SkiBased);
+        packScratch.assign(tpacks.size(), PriceScratch());
+        victims.clear();
+        packChanged.assign(tpacks.size(), 0);
+        partialFlushes = 0;
+        if(settings.packThreads > 1 && !packPool)
+            packPool.reset(new ThreadPool(settings.packThreads));
+        queriesAtChoice.assign(tpacks.size(), 0);
+        policySwitches = 0;
+        filters = perTermPack(alg()) && settings.filterBitsPerKey > 0;
+        filterPostings = peakFilterPostings = 0;
+        skippedProbes = 0;
+        if(filters) //a Bloom filter with the optimal number of hash functions
+            for(auto& tp : tpacks)
+                tp.setFilters(std::pow(0.6185, settings.filterBitsPerKey));
+        if(settings.queryStream) {
+            queryRng = CounterRNG(settings.queryStream);
+            queryPacks.init(settings.tpQueries.begin(), settings.tpQueries.end());
+        }
+        if(!settings.snapshots.load.empty()) { //last: the cache has its final size by now
+            cache.load(runFile(settings.snapshots.load, ".ulcs"));
+            warmTerms = cache.cache.size();
+            warmPostings = cache.cache.getTotalP();
+        }
     }
 
-    double SimulatorIMP::allTimes() const { return getTotalQTime()+getMergeTimes(); }
+    template<typename AlgPolicy, typename CachePolicy>
+    double SimulatorIMP<AlgPolicy, CachePolicy>::allTimes() const { return getTotalQTime()+getMergeTimes(); }
 
-    std::string SimulatorIMP::report(Algorithm alg) const{
+    template<typename AlgPolicy, typename CachePolicy>
+    std::string SimulatorIMP<AlgPolicy, CachePolicy>::report() const{
         double totalQueryTime = getTotalQTime();
         double mergeTimes = getMergeTimes();
 
         std::stringstream strstr;
         strstr <<
-                 Settings::name(alg) << " " << (settings.diskType==HD?"HD":"SSD") <<
+                 Settings::name(alg()) << " " << (settings.diskType==HD?"HD":"SSD") <<
                 " " << settings.flags[0] << "--" << settings.flags[1] <<
                 " Evictions: " << std::setw(5) << evictions <<
                 " Total-seen-postings: " << totalSeenPostings <<
@@ -208,137 +706,574 @@ namespace IndexUpdate {
                 " Consolidation: " << merges <<
                 " Total-query-minutes: " << totalQueryTime <<
                 " Total-merge-minutes: " << mergeTimes <<
-                " Sum-All: " << totalQueryTime+mergeTimes <<
-                std::endl;
+                " Sum-All: " << totalQueryTime+mergeTimes;
+        if(device.enabled())
+            device.report(strstr);
+        if(mergeStream.enabled())
+            mergeStream.report(strstr);
+        const MergeMemory defaultMerges;
+        if(!(settings.mergeMemory == defaultMerges))
+            strstr << " Merge-memory: postings: " << settings.mergeMemory.postings <<
+                   " streams: " << settings.mergeMemory.streams << " from-cache: " << settings.mergeMemory.fromCache <<
+                   " cache-postings: " << settings.cacheSizePostings;
+        if(memory.enabled())
+            memory.report(strstr);
+        if(telemetry)
+            telemetry->report(strstr);
+        if(!settings.snapshots.load.empty())
+            strstr << " Warm-start: terms: " << warmTerms << " postings: " << warmPostings;
+        if(settings.coherence != PatchOnHit)
+            strstr << " Coherence: " << (settings.coherence == RefreshStale ? "refresh" : "invalidate") <<
+                   " stale-terms: " << cache.staleTerms << " refreshed: " << cache.refreshedTerms <<
+                   " invalidated: " << cache.invalidatedTerms << " refresh-reads: " << cache.refreshReads <<
+                   " refresh-minutes: " << costIoInMinutes(cache.refreshReads, settings.ioMBS, settings.ioSeek,
+                                                           settings.szOfPostingBytes) <<
+                   " stale-hits: " << cache.cache.cacheStaleHits + cache.tier.cacheStaleHits;
+        if(workload.enabled()) {
+            double offPeak = 0, all = 0;
+            strstr << " Workload: pieces: " << workload.size() << " period-sec: " << settings.workload.periodSec <<
+                   " merge-minutes-by-piece:";
+            for(size_t i = 0; i < pieceMergeMinutes.size(); ++i) {
+                strstr << (i ? "/" : " ") << pieceMergeMinutes[i];
+                all += pieceMergeMinutes[i];
+                if(workload.offPeak(i))
+                    offPeak += pieceMergeMinutes[i];
+            }
+            strstr << " off-peak-merge-pct: " << (all > 0 ? 100.0 * offPeak / all : 0.0);
+        }
+        if(perTermPack(alg()) && alg() != Prognosticator && settings.evictionOrder == BenefitPerIO)
+            strstr << " Eviction-order: benefit-per-io";
+        if(perTermPack(alg()) && settings.flushPostings)
+            strstr << " Partial-flushes: segment-postings: " << settings.flushPostings << " partial: " << partialFlushes;
+        if(perTermPack(alg()) && alg() != Prognosticator && settings.packPolicies.reevaluateEvictions)
+            strstr << " Pack-policies: never: " << std::count(packPolicy.begin(), packPolicy.end(), NeverMerge) <<
+                   " log: " << std::count(packPolicy.begin(), packPolicy.end(), LogMerge) <<
+                   " ski: " << std::count(packPolicy.begin(), packPolicy.end(), SkiBased) <<
+                   " switches: " << policySwitches;
+        if(compression.enabled()) {
+            compression.report(strstr);
+            strstr << " cpu-query-minutes: " << compression.decodeMinutes(queryPostingsDecoded) <<
+                   " cpu-merge-minutes: " << compression.decodeMinutes(rawMerges.reads.postings) +
+                                             compression.encodeMinutes(rawMerges.writes.postings);
+        }
+        if(filters)
+            strstr << " Filters: bits-per-key: " << settings.filterBitsPerKey <<
+                   " memory-postings: " << filterPostings << " peak: " << peakFilterPostings <<
+                   " probes-skipped: " << skippedProbes;
+        tails.report(strstr);
+        if(settings.deletes.perPosting > 0) {
+            uint64_t disk = 0, garbage = 0, reclaimed = 0;
+            for(const auto& tp : tpacks) {
+                disk += tp.diskPostings();
+                garbage += tp.garbage();
+                reclaimed += tp.reclaimed();
+            }
+            strstr << " Deletes: per-posting: " << settings.deletes.perPosting <<
+                   " garbage-trigger: " << settings.deletes.garbageTrigger <<
+                   " disk-postings: " << disk << " garbage-pct: " << (disk ? double(garbage) / double(disk) * 100.0 : 0.0) <<
+                   " reclaimed: " << reclaimed;
+        }
+        if(settings.cacheTier.postings)
+            strstr << " Cache-tier: " << (settings.cacheTier.inclusion == ExclusiveTier ? "exclusive" : "inclusive") <<
+                   " postings: " << settings.cacheTier.postings << " tier-reads: " << tierReads <<
+                   " tier-query-minutes: " << costIoInMinutes(tierReads, settings.cacheTier.ioMBS,
+                                                              settings.cacheTier.ioSeek, settings.szOfPostingBytes) <<
+                   " demoted-postings: " << cache.demotedPostings;
+        if(settings.reportMemory)
+            reportMemory(strstr);
+        strstr << ' ';
+        cache.report(strstr, totalQs);
         return strstr.str();
     }
 
-    double SimulatorIMP::getMergeTimes() const {
+    template<typename AlgPolicy, typename CachePolicy>
+    double SimulatorIMP<AlgPolicy, CachePolicy>::getMergeTimes() const {
         auto mergeTimes = ConsolidationStats::costInMinutes(merges,
                                                             settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+        if(compression.enabled())
+            mergeTimes += compression.decodeMinutes(rawMerges.reads.postings) +
+                          compression.encodeMinutes(rawMerges.writes.postings);
         return mergeTimes;
     }
 
-    double SimulatorIMP::getTotalQTime() const {
+    template<typename AlgPolicy, typename CachePolicy>
+    double SimulatorIMP<AlgPolicy, CachePolicy>::getTotalQTime() const {
         auto totalQueryTime = costIoInMinutes(totalQueryReads,
                                               settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+        if(compression.enabled())
+            totalQueryTime += compression.decodeMinutes(queryPostingsDecoded);
+        if(settings.cacheTier.postings)
+            totalQueryTime += costIoInMinutes(tierReads, settings.cacheTier.ioMBS, settings.cacheTier.ioSeek,
+                                              settings.szOfPostingBytes);
+        if(settings.coherence == RefreshStale)
+            totalQueryTime += costIoInMinutes(cache.refreshReads, settings.ioMBS, settings.ioSeek,
+                                              settings.szOfPostingBytes);
         return totalQueryTime;
     }
 
-    void SimulatorIMP::handleQueries() {
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::handleQueries() {
         auto total = totalSeenPostings+postingsInUpdateBuffer;
         if(total >= lastQueryAtPostings + settings.updatesQuant) {
             auto totalNew = total - lastQueryAtPostings;
             auto carry = totalNew % settings.updatesQuant;
             assert(total > carry);
+            const auto firstAt = lastQueryAtPostings;
             lastQueryAtPostings = total - carry;
 
             //ask your quant of queries
-            auto quant = settings.quieriesQuant * (totalNew / settings.updatesQuant);
-            assert(quant);
+            double arrivalMs = workload.postingsToMs(firstAt);
+            const double untilMs = workload.postingsToMs(lastQueryAtPostings);
+            uint64_t quant;
+            double stepMs = 0, firstQuery = 0, stepQueries = 0, asked = 0;
+            if(!workload.enabled()) {
+                quant = settings.quieriesQuant * (totalNew / settings.updatesQuant);
+                assert(quant);
+                //on the timeline the queries arrive evenly while the new postings come in
+                stepMs = (untilMs - arrivalMs) / quant;
+                queryRateQps = stepMs > 0 ? 1000.0 / stepMs : 0;
+            }
+            else { //the queries the profile asks meanwhile, each at its time
+                firstQuery = workload.queriesAt(arrivalMs);
+                const double queries = workload.queriesAt(untilMs) - firstQuery;
+                queryCarry += queries;
+                quant = uint64_t(queryCarry);
+                queryCarry -= double(quant);
+                if(!quant)
+                    return;
+                stepQueries = queries / double(quant);
+            }
+            uint64_t asking = totalQs; //the telemetry's query count
             totalQs += quant;
             //currently RoundRobin -- may replace with a discrete distribution
-            for(; quant != 0; --quant, queriesStoppedAt = (queriesStoppedAt+1)%tpacks.size()) {
-                bool isMiss = ! cache.visit(queriesStoppedAt,tpacks[queriesStoppedAt].meanDiskLength());
-                if(isMiss)
-                   totalQueryReads += tpacks[queriesStoppedAt].query();
+            while(quant) {
+                auto count = std::min(quant, queryBatchSize);
+                batchPacks.clear();
+                for(uint64_t i = 0; i < count; ++i) {
+                    if(settings.queryStream)
+                        batchPacks.push_back(queryPacks(queryRng));
+                    else {
+                        batchPacks.push_back(queriesStoppedAt);
+                        queriesStoppedAt = (queriesStoppedAt+1)%tpacks.size();
+                    }
+                }
+                cache.visitBatch(tpacks, batchPacks);
+                const auto& hits = cache.batchResult.hits;
+                for(size_t i = 0; i < count; ++i) {
+                    if(workload.enabled()) {
+                        arrivalMs = workload.queryMs(firstQuery + ++asked * stepQueries);
+                        queryRateQps = workload.qps(arrivalMs);
+                    }
+                    else
+                        arrivalMs += stepMs;
+                    if(mergeStream.enabled()) //the segment counts as of now
+                        advanceMerges(arrivalMs);
+                    double latencyMs = 0;
+                    ReadIO indexReads; //in postings, whatever the codec
+                    if(cache.tierHit(i)) { //a list read from the tier, the index is not touched
+                        const ReadIO reads(cache.batch[i].second, 1);
+                        tierReads += reads;
+                        latencyMs = ioLatencyMs(reads, settings.cacheTier.ioMBS, settings.cacheTier.ioSeek,
+                                                settings.szOfPostingBytes);
+                    }
+                    else if(!hits[i]) {
+                        if(settings.evictionOrder == BenefitPerIO)
+                            touched(batchPacks[i]);
+                        auto& tp = tpacks[batchPacks[i]];
+                        const int64_t visible = tp.segments().size() + tp.unmerged();
+                        auto reads = tp.query();
+                        indexReads = reads;
+                        if(filters && visible)
+                            skippedProbes += visible - int64_t(reads.seeks);
+                        if(compression.enabled()) {
+                            queryPostingsDecoded += reads.postings;
+                            reads = compression.storedQuery(int(batchPacks[i]), reads);
+                        }
+                        totalQueryReads += reads;
+                        latencyMs = device.enabled() ? device.query(arrivalMs, reads) :
+                                    ioLatencyMs(reads, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+                    }
+                    tails.seeks.record(indexReads.seeks);
+                    tails.postings.record(indexReads.postings);
+                    tails.latencyUs.record(uint64_t(latencyMs * 1000.0));
+                    if(latencySink)
+                        latencySink->push_back(latencyMs);
+                    if(nextSampleAt && ++asking >= nextSampleAt && telemetry) {
+                        sample(asking);
+                        nextSampleAt += settings.telemetry.everyQueries;
+                    }
+                }
+                quant -= count;
             }
         }
     }
 
-    void SimulatorIMP::fillUpdateBuffer() {
-        while (!bufferFull()) {
-            for(auto& tp : tpacks) //round robin
-                postingsInUpdateBuffer += tp.addUBPostings();
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::fillUpdateBuffer(uint64_t untilPostings) {
+        while (!bufferFull() && totalSeenPostings + postingsInUpdateBuffer < untilPostings) {
+            const auto& mix = workload.packMix(nowMs()); //a re-index burst may favour some packs
+            for(auto& tp : tpacks) { //round robin
+                const auto added = mix.empty() ? tp.addUBPostings() : tp.addWeightedUBPostings(mix[tp.id()]);
+                postingsInUpdateBuffer += added;
+                if(settings.deletes.perPosting > 0)
+                    tombstonesInUpdateBuffer += tp.addDeletes(double(added) * settings.deletes.perPosting);
+            }
             if(finished())
                 break;
         }
+        if(settings.evictionOrder == BenefitPerIO) //every pack got postings
+            for(const auto& tp : tpacks)
+                touched(tp.id());
     }
 
-    void SimulatorIMP::evictMonoliths(Algorithm alg) {
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::evictMonoliths() {
+        uint64_t written = 0, disk = 0, garbage = 0;
         for(auto& tp : tpacks) {
-            auto newPostings = tp.evictAll();
+            tp.flush();
             auto& segments = tp.unsafeGetSegments();
+            const auto newPostings = segments.back();
             segments.clear();
             segments.push_back(newPostings);
+            written += newPostings;
+            disk += tp.diskPostings();
+            garbage += tp.garbage();
         }
         //consolidation cost is calc. here...
-        monolithicSegments.push_back(postingsInUpdateBuffer);
+        monolithicSegments.push_back(written);
         totalSeenPostings += postingsInUpdateBuffer;
-        postingsInUpdateBuffer = 0;
+        postingsInUpdateBuffer = tombstonesInUpdateBuffer = 0;
 
-        auto offset = (LogMerge == alg) ? offsetOfTelescopicMerge(monolithicSegments) :
+        const auto segmentsBefore = monolithicSegments.size();
+        auto offset = (LogMerge == alg()) ? offsetOfTelescopicMerge(monolithicSegments) :
                                 (monolithicSegments.size() > 1 ? 0 : 1);
+        if(settings.deletes.garbageTrigger > 0 && disk && double(garbage) / double(disk) > settings.deletes.garbageTrigger)
+            offset = 0; //compaction
 
         //override for NeverMerge
-        if(NeverMerge == alg) offset = monolithicSegments.size()-1;
+        if(NeverMerge == alg()) offset = monolithicSegments.size()-1;
         assert(offset<=monolithicSegments.size());
 
-        if(offset<monolithicSegments.size()-1)
-            merges += consolidateSegments(monolithicSegments, offset);
+        ConsolidationStats cost;
+        if(offset<monolithicSegments.size()-1) {
+            const auto rewritten = std::accumulate(monolithicSegments.begin()+offset, monolithicSegments.end(),
+                                                   uint64_t(0));
+            cost = consolidateSegments(monolithicSegments, offset, mergeModel(settings));
+            //every pack has its share of the rewritten postings; the reclaimed ones are not written back
+            uint64_t gone = 0;
+            for(auto& tp : tpacks)
+                gone += tp.reclaim(disk ? double(rewritten) / double(disk) : 0.0, offset == 0);
+            monolithicSegments.back() -= gone;
+            cost.writes.postings -= std::min<uint64_t>(gone, cost.writes.postings);
+        }
         else
-            merges += WriteIO(monolithicSegments.back(),1);
+            cost += WriteIO(monolithicSegments.back(),1);
+        merged(-1, segmentsBefore, monolithicSegments.size(), cost);
 
+        std::fill(packChanged.begin(), packChanged.end(), 1); //every pack flushed
         //fix segment sizes for tpacks (this how we know during queries how many seeks to make)
         unsigned currentSzAll = monolithicSegments.size();
         for(auto& tp : tpacks)
             tp.unsafeGetSegments().resize(currentSzAll);
     }
 
-    void SimulatorIMP::evictTPacks(Algorithm alg) {
-        uint64_t desiredCapacity = settings.percentsUBLeft * settings.updateBufferPostingsLimit / 100;
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::evictTPacks() {
+        const auto period = settings.packPolicies.reevaluateEvictions;
+        if(period && (evictions-1) % period == 0)
+            choosePackPolicies();
+        if(settings.evictionOrder == BenefitPerIO) {
+            evictByBenefit();
+            return;
+        }
+        uint64_t desiredCapacity = settings.percentsUBLeft * updateBufferLimit / 100;
         //we evict castes with larger ID first
-        for(auto it = tpacks.rbegin(); postingsInUpdateBuffer > desiredCapacity && it !=tpacks.rend(); ++it)   {
-            TermPack& tp = *it;
-            auto newPostings = tp.evictAll();
-            tp.unsafeGetSegments().push_back(newPostings);
+        uint64_t load = bufferLoad();
+        victims.clear();
+        for(auto it = tpacks.rbegin(); load > desiredCapacity && it !=tpacks.rend(); ++it) {
+            const auto limit = flushLimit(load - desiredCapacity);
+            load -= it->flushLoad(limit);
+            victims.emplace_back(it->id(), -1, limit);
+        }
+        evictVictims();
+        assert(bufferLoad() <= desiredCapacity);
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::evictSki(TermPack& tp, uint64_t room) {
+        PackEviction victim(tp.id(), -1, flushLimit(room));
+        consolidateVictim(victim);
+        settleVictim(victim);
+    }
 
-            totalSeenPostings += newPostings;
-            postingsInUpdateBuffer -= newPostings;
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::consolidateVictim(PackEviction& victim) {
+        TermPack& tp = tpacks[victim.pack];
+        victim.tombstones = tp.flushLoad(victim.limit) - std::min(victim.limit, tp.bufferedPostings());
+        victim.postings = tp.flush(victim.limit);
+        victim.segmentsBefore = tp.segments().size();
+        if(victim.offset >= 0) {
+            victim.cost = consolidateTP(tp, unsigned(victim.offset), settings);
+            return;
+        }
+        switch(packPolicy[victim.pack]) {
+            case NeverMerge: victim.cost = consolidateTP(tp, unsigned(victim.segmentsBefore-1), settings); break;
+            case LogMerge: victim.cost = consolidateTPStatic(tp); break;
+            default: victim.cost = consolidateTPSki(tp, settings, packScratch[victim.pack]);
+        }
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::settleVictim(const PackEviction& victim) {
+        tombstonesInUpdateBuffer -= victim.tombstones;
+        packChanged[victim.pack] = 1;
+        if(tpacks[victim.pack].bufferedPostings())
+            ++partialFlushes;
+        totalSeenPostings += victim.postings;
+        postingsInUpdateBuffer -= victim.postings;
+        merged(int(victim.pack), victim.segmentsBefore, tpacks[victim.pack].segments().size(), victim.cost);
+    }
 
-            merges += consolidateTPSki(tp); //consolidateTPStatic(tp);
+    template<typename AlgPolicy, typename CachePolicy>
+    uint64_t SimulatorIMP<AlgPolicy, CachePolicy>::flushLimit(uint64_t room) const {
+        const auto target = settings.flushPostings;
+        if(!target || room > UINT64_MAX - target)
+            return UINT64_MAX;
+        return (room + target - 1) / target * target;
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::evictVictims() {
+        if(packPool && victims.size() > 1)
+            packPool->parallelFor(victims.size(), [this](size_t i) { consolidateVictim(victims[i]); });
+        else
+            for(auto& victim : victims)
+                consolidateVictim(victim);
+        for(const auto& victim : victims)
+            settleVictim(victim);
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::choosePackPolicies() {
+        const double seekMs = ioLatencyMs(ReadIO(0, 1), settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+        for(auto& tp : tpacks) {
+            const auto id = tp.id();
+            const auto queries = tp.diskQueries() - queriesAtChoice[id];
+            queriesAtChoice[id] = tp.diskQueries();
+            const auto onDisk = tp.receivedPostings() - tp.bufferedPostings();
+            if(!onDisk)
+                continue; //nothing to merge yet
+            const double mergeMs =
+                    ioLatencyMs(ReadIO(onDisk, tp.segments().size()),
+                                settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes) +
+                    ioLatencyMs(WriteIO(onDisk, 1), settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+            const double rho = double(queries) * seekMs / mergeMs;
+            const Algorithm policy = rho < settings.packPolicies.neverBelow ? NeverMerge :
+                                     (rho > settings.packPolicies.logAbove ? LogMerge : SkiBased);
+            if(policy == packPolicy[id])
+                continue;
+            //what the seeks earned under the old policy is not the ski rental's to spend
+            tp.reduceTokens(tp.convertSeeksToTokens(0));
+            packPolicy[id] = policy;
+            ++policySwitches;
         }
-        assert(postingsInUpdateBuffer <= desiredCapacity);
     }
 
+    template<typename AlgPolicy, typename CachePolicy>
+    double SimulatorIMP<AlgPolicy, CachePolicy>::evictionBenefit(const TermPack& tp) const {
+        const auto buffered = tp.bufferedPostings() + tp.bufferedTombstones();
+        if(!buffered)
+            return 0;
+        //query pressure: the pack's disk queries per ingested posting since its last flush
+        const double span = double(totalSeenPostings + postingsInUpdateBuffer - postingsAtFlush[tp.id()]);
+        const double pressure = span > 0 ? double(tp.diskQueries() - queriesAtFlush[tp.id()]) / span : 0.0;
+        //the flush writes the postings, and for (about) the next buffer of postings every query of
+        //the pack reads its share of them from disk, in one more segment (until a merge)
+        const double writeMinutes = ioLatencyMs(WriteIO(buffered, 1),
+                                                settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes) / 60000.0;
+        const double readMinutes = ioLatencyMs(ReadIO(buffered / tp.members(), 1),
+                                               settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes) / 60000.0;
+        return double(buffered) / (writeMinutes + pressure * double(updateBufferLimit) * readMinutes);
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::evictByBenefit() {
+        for(auto id : stalePacks) {
+            evictionIndex.update(id, evictionBenefit(tpacks[id]));
+            benefitStale[id] = 0;
+        }
+        stalePacks.clear();
+
+        uint64_t desiredCapacity = settings.percentsUBLeft * updateBufferLimit / 100;
+        while(bufferLoad() > desiredCapacity && !evictionIndex.empty()) {
+            auto id = evictionIndex.top();
+            TermPack& tp = tpacks[id];
+            evictSki(tp, bufferLoad() - desiredCapacity);
+            queriesAtFlush[id] = tp.diskQueries();
+            postingsAtFlush[id] = totalSeenPostings + postingsInUpdateBuffer;
+            evictionIndex.update(id, evictionBenefit(tp));
+        }
+        assert(bufferLoad() <= desiredCapacity);
+    }
 
-    void SimulatorIMP::evictFromUpdateBuffer(Algorithm alg) {
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::evictForecast() {
+        uint64_t desiredCapacity = settings.percentsUBLeft * updateBufferLimit / 100;
+        forecaster.observe(tpacks, totalSeenPostings + postingsInUpdateBuffer);
+        plans.clear();
+        for(const auto& tp : tpacks)
+            if(tp.bufferedPostings() || tp.bufferedTombstones())
+                plans.push_back(forecaster.plan(tp));
+        //the cheapest room first (ties: larger ID first, as in evictTPacks)
+        std::sort(plans.begin(), plans.end(), [](const Forecaster::Plan& a, const Forecaster::Plan& b) {
+            return a.extraMinutes != b.extraMinutes ? a.extraMinutes < b.extraMinutes : a.pack > b.pack;
+        });
+        uint64_t load = bufferLoad();
+        victims.clear();
+        for(auto it = plans.begin(); load > desiredCapacity && it != plans.end(); ++it) {
+            const auto limit = flushLimit(load - desiredCapacity);
+            load -= tpacks[it->pack].flushLoad(limit);
+            victims.emplace_back(it->pack, int(it->offset), limit);
+        }
+        evictVictims();
+        assert(bufferLoad() <= desiredCapacity);
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::evictFromUpdateBuffer() {
         ++evictions;
+        const auto before = merges;
 
-        if(alg != SkiBased && alg != Prognosticator)
-            evictMonoliths(alg);
+        if(!perTermPack(alg()))
+            evictMonoliths();
+        else if(alg() == Prognosticator)
+            evictForecast();
         else
-            evictTPacks(alg);
+            evictTPacks();
+        if(settings.coherence != PatchOnHit)
+            cohere();
+
+        if(mergeStream.enabled())
+            advanceMerges(nowMs());
+        else if(device.enabled()) //the merges of this eviction go to the background
+            device.merge(nowMs(), merges - before);
+        if(memory.enabled())
+            repartition(merges - before);
+        if(filters)
+            chargeFilters();
+        if(telemetry && !settings.telemetry.everyQueries)
+            sample(totalQs);
         //std::cout << totalSeenPostings << std::endl;
     }
 
-    bool SimulatorIMP::bufferFull() const {
-        return postingsInUpdateBuffer >= settings.updateBufferPostingsLimit;
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::cohere() {
+        cache.cohere(tpacks, packChanged, settings.coherence == RefreshStale);
+        std::fill(packChanged.begin(), packChanged.end(), 0);
     }
 
-    bool SimulatorIMP::finished() const {
-        return totalSeenPostings + postingsInUpdateBuffer >= settings.totalExperimentPostings;
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::chargeFilters() {
+        double keys = 0;
+        for(const auto& tp : tpacks)
+            keys += tp.filterKeys();
+        filterPostings = uint64_t(std::ceil(keys * settings.filterBitsPerKey / 8.0 / settings.szOfPostingBytes));
+        peakFilterPostings = std::max(peakFilterPostings, filterPostings);
+        const uint64_t cacheBudget = memory.enabled() ? memory.cacheSize() : settings.cacheSizePostings;
+        cache.cache.setMaxPostings(cacheBudget > filterPostings ? cacheBudget - filterPostings : 0);
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::merged(int packId, uint64_t segmentsBefore, uint64_t segmentsAfter,
+                                                const ConsolidationStats& postings) {
+        rawMerges += postings;
+        const ConsolidationStats cost = !compression.enabled() ? postings :
+                compression.storedMerge(packId, postings, segmentsBefore - segmentsAfter + 1);
+        merges += cost;
+        if(workload.enabled() && !mergeStream.enabled()) //a background merge counts when it starts
+            pieceMergeMinutes[workload.pieceAt(nowMs())] +=
+                    ConsolidationStats::costInMinutes(cost, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+        if(!mergeStream.enabled())
+            return;
+        const unsigned unmerged = unsigned(segmentsBefore - segmentsAfter);
+        unmergedSegments(packId, int(unmerged));
+        mergeStream.submit(nowMs(), packId, unmerged, cost);
     }
 
-    void auxRebuildCPrice(std::vector<double> &consolidationPriceVector, const std::vector<size_t>& sizeStack,
-                          const Settings &settings, double stopForTokens) {
-        const int sz = sizeStack.size();
-        assert(sz >= 2);
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::repartition(const ConsolidationStats& cost) {
+        const auto& shadow = cache.cache.shadow();
+        //one seek per query the shadow would have served
+        const ReadIO saved(shadow.postings - shadowPostingsSeen, shadow.hits - shadowHitsSeen);
+        shadowPostingsSeen = shadow.postings;
+        shadowHitsSeen = shadow.hits;
+        const ReadIO served(cache.cache.cachePostingsServed - servedSeen, cache.cache.cacheHits - hitsSeen);
+        servedSeen = cache.cache.cachePostingsServed;
+        hitsSeen = cache.cache.cacheHits;
+        //the seeks to more than one segment per query: the other half of what smaller buffers cost
+        const auto reads = totalQueryReads - queryReadsSeen;
+        const auto misses = (totalQs - queriesSeen) - served.seeks;
+        const double fragmentation = reads.seeks > misses ? double(reads.seeks - misses) * settings.ioSeek / 60000.0 : 0.0;
+        queryReadsSeen = totalQueryReads;
+        queriesSeen = totalQs;
+        const auto now = totalSeenPostings + postingsInUpdateBuffer;
+        const bool moved = memory.decide(
+                ConsolidationStats::costInMinutes(cost, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes) +
+                fragmentation,
+                costIoInMinutes(served, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes),
+                costIoInMinutes(saved, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes),
+                now - partitionedAtPostings);
+        partitionedAtPostings = now;
+        if(moved) {
+            updateBufferLimit = memory.updateBuffer();
+            cache.cache.setMaxPostings(memory.cacheSize());
+        }
+    }
 
-        consolidationPriceVector.clear();
-        consolidationPriceVector.resize(sz,std::numeric_limits<float>::max());
-        for(int i = 2; i <=sz; ++i) {
-            auto cons = kWayConsolidate(sizeStack.begin()+(sz-i),sizeStack.end());
-            consolidationPriceVector[sz-i] =
-                    ConsolidationStats::costInMinutes(cons, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::advanceMerges(double atMs) {
+        mergeStream.advance(atMs, queryRateQps,
+                            [this](const MergeScheduler::Job& job) {
+                                if(device.enabled())
+                                    device.merge(job.startMs, job.cost, mergeStream.budget());
+                                if(workload.enabled())
+                                    pieceMergeMinutes[workload.pieceAt(job.startMs)] +=
+                                            ConsolidationStats::costInMinutes(job.cost, settings.ioMBS, settings.ioSeek,
+                                                                              settings.szOfPostingBytes);
+                            },
+                            [this](const MergeScheduler::Job& job) {
+                                unmergedSegments(job.packId, -int(job.unmergedSegments));
+                            });
+    }
 
-            if(consolidationPriceVector[sz-i] > stopForTokens)
-                break; //no point to calculate the other ones
+    template<typename AlgPolicy, typename CachePolicy>
+    void SimulatorIMP<AlgPolicy, CachePolicy>::sample(uint64_t queries) {
+        TelemetryRecord record = TelemetryRecord();
+        record.evictions = evictions;
+        record.postings = totalSeenPostings + postingsInUpdateBuffer;
+        record.queries = queries;
+        record.clockMs = nowMs();
+        record.queryMinutes = getTotalQTime();
+        record.mergeMinutes = getMergeTimes();
+        record.bufferFill = updateBufferLimit ? double(bufferLoad()) / double(updateBufferLimit) : 0.0;
+        //the cache has seen the whole batch of the query
+        record.hitPct = queries ? std::min(100.0, double(cache.cache.cacheHits) / double(queries) * 100.0) : 0.0;
+        for(const auto& tp : tpacks) {
+            record.tokens += double(tp.tokens());
+            ++record.segments[TelemetryRecord::bucketOf(tp.segments().size())];
         }
-        consolidationPriceVector[sz-1] = //no real consolidation - just a write-back of the last one
-                ConsolidationStats::costInMinutes(
-                        ConsolidationStats(0,0,sizeStack.back(),1),
-                          settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+        telemetry->push(record);
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    bool SimulatorIMP<AlgPolicy, CachePolicy>::bufferFull() const {
+        return bufferLoad() >= updateBufferLimit;
+    }
+
+    template<typename AlgPolicy, typename CachePolicy>
+    bool SimulatorIMP<AlgPolicy, CachePolicy>::finished() const {
+        return totalSeenPostings + postingsInUpdateBuffer >= settings.totalExperimentPostings;
     }
 
 }
@@ -6,8 +6,17 @@
 namespace IndexUpdate {
 
     namespace Simulator {
+        //throws std::invalid_argument for settings with both shards and replicas
         std::vector<std::string> simulate(const std::vector<Algorithm>& algs, const Settings &);
         double simulateOne(Algorithm alg, const Settings &);
+        //Monte Carlo replicas (see Settings::replicas): reports mean and 95% CI of the costs and hit-pct
+        std::vector<std::string> replicate(const std::vector<Algorithm>& algs, const Settings &);
+        //a cluster of one node per settings, advanced in parallel on a common clock;
+        //every query fans out to all the nodes and completes with the slowest one
+        std::string simulateSharded(Algorithm alg, const std::vector<Settings>& shards);
+        //same as simulateOne, on an engine specialized at compile time per algorithm and with the
+        //CRTP cache (Caching::StaticLandlord); kept for Benchmark.cpp, it measured no faster
+        double simulateSpecialized(Algorithm alg, const Settings &);
     }
 }
 
@@ -0,0 +1,85 @@
+#include "SkiRental.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace IndexUpdate {
+
+    unsigned skiRentalOffset(TermPack& tp, const Settings& settings, PriceScratch& priceScratch) {
+        const auto& segments = tp.segments();
+        if(segments.size()<2)
+            return segments.size()-1;
+
+        double tokens = tp.convertSeeksToTokens( //exchange seeks for tokens
+                             costIoInMinutes(ReadIO(0,tp.extraSeeks()),
+                                settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes));
+
+        auxRebuildCPrice(priceScratch, segments, settings,tokens);
+
+        auto i = int(priceScratch.size()-1);
+        while(i>=0 && tokens >= priceScratch[size_t(i)])
+            --i;
+        unsigned offset = i+1;
+        assert(offset<=segments.size());
+        return offset;
+    }
+
+    MergeModel mergeModel(const Settings& settings) {
+        const auto& memory = settings.mergeMemory;
+        const unsigned streams = std::max(memory.streams, 1u);
+        //at least a few buffers of 4K postings per stream
+        return MergeModel(std::max<uint64_t>(memory.postings / streams, 1 << 14),
+                          settings.diskType == HD && streams > 1);
+    }
+
+    bool needsCompaction(const TermPack& tp, const Settings& settings) {
+        return settings.deletes.garbageTrigger > 0 && tp.garbageRatio() > settings.deletes.garbageTrigger;
+    }
+
+    ConsolidationStats consolidateTP(TermPack& tp, unsigned offset, const Settings& settings) {
+        auto& segments = tp.unsafeGetSegments();
+        const bool compaction = needsCompaction(tp, settings);
+        offset = consolidationOffset(tp, offset, settings);
+        //a compaction rewrites a single segment too, or its garbage would stay for good
+        if(offset+1<segments.size() || compaction) {
+            const auto rewritten = std::accumulate(segments.begin()+offset, segments.end(), uint64_t(0));
+            const auto disk = tp.diskPostings();
+            auto cons = segments.size() > 1 ? consolidateSegments(segments, offset, mergeModel(settings)) :
+                        ConsolidationStats(segments.back(), 1, segments.back(), 1);
+            //the reclaimed postings are read but not written back
+            const auto gone = tp.reclaim(disk ? double(rewritten) / double(disk) : 0.0, offset == 0);
+            segments.back() -= gone;
+            cons.writes.postings -= std::min<uint64_t>(gone, cons.writes.postings);
+            tp.reduceTokens(ConsolidationStats::costInMinutes(cons,
+                                            settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes));
+            return cons;
+        }
+
+        ConsolidationStats nil;
+        nil += WriteIO(segments.back(),0); //0 since we write all non-consolidants together
+        return nil;
+    }
+
+    void auxRebuildCPrice(PriceScratch &consolidationPriceVector, const SegmentStack& sizeStack,
+                          const Settings &settings, double stopForTokens) {
+        const int sz = sizeStack.size();
+        assert(sz >= 2);
+
+        consolidationPriceVector.clear();
+        consolidationPriceVector.resize(sz,std::numeric_limits<float>::max());
+        const MergeModel model = mergeModel(settings);
+        for(int i = 2; i <=sz; ++i) {
+            auto cons = kWayConsolidate(sizeStack.begin()+(sz-i),sizeStack.end(), model);
+            consolidationPriceVector[sz-i] =
+                    ConsolidationStats::costInMinutes(cons, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+
+            if(consolidationPriceVector[sz-i] > stopForTokens)
+                break; //no point to calculate the other ones
+        }
+        consolidationPriceVector[sz-1] = //no real consolidation - just a write-back of the last one
+                ConsolidationStats::costInMinutes(
+                        ConsolidationStats(0,0,sizeStack.back(),1),
+                          settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+    }
+}
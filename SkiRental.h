@@ -0,0 +1,41 @@
+#ifndef UPDATE_LITE_SKIRENTAL_H
+#define UPDATE_LITE_SKIRENTAL_H
+
+#include "Settings.h"
+#include "TermPack.h"
+
+namespace IndexUpdate {
+
+    typedef TrackedVector<double, ScratchMemory> PriceScratch;
+
+    void auxRebuildCPrice(PriceScratch &consolidationPriceVector, const SegmentStack& sizeStack,
+                          const Settings &settings, double stopForTokens);
+
+    //the extra seeks the pack's queries made since the last decision are exchanged for tokens,
+    //and the deepest suffix of segments the tokens can pay for is chosen.
+    //returns the offset of the first segment to consolidate; size()-1 means just write the last one
+    unsigned skiRentalOffset(TermPack& tp, const Settings& settings, PriceScratch& priceScratch);
+
+    //the memory and I/O of a merge on one of the streams of settings.mergeMemory
+    MergeModel mergeModel(const Settings& settings);
+
+    //true if the pack is above the garbage trigger: consolidateTP then compacts it from
+    //offset 0, even a single segment, so the tombstones go too
+    bool needsCompaction(const TermPack& tp, const Settings& settings);
+
+    //the offset consolidateTP consolidates from when asked for offset
+    inline unsigned consolidationOffset(const TermPack& tp, unsigned offset, const Settings& settings) {
+        return needsCompaction(tp, settings) ? 0 : offset;
+    }
+
+    //consolidates the segments from consolidationOffset on (if more than one, or a compaction)
+    //and pays with the pack's tokens
+    ConsolidationStats consolidateTP(TermPack& tp, unsigned offset, const Settings& settings);
+
+    inline ConsolidationStats consolidateTPSki(TermPack& tp, const Settings& settings,
+                                               PriceScratch& priceScratch) {
+        return consolidateTP(tp, skiRentalOffset(tp, settings, priceScratch), settings);
+    }
+}
+
+#endif //UPDATE_LITE_SKIRENTAL_H
@@ -0,0 +1,100 @@
+#include <iostream>
+
+#include "SkiRental.h"
+#include "Advisor.h"
+#include "Profiles.h"
+
+using namespace IndexUpdate;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if(!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+static double minutesOf(const ConsolidationStats& cost, const Settings& settings) {
+    return ConsolidationStats::costInMinutes(cost, settings.ioMBS, settings.ioSeek, settings.szOfPostingBytes);
+}
+
+//1000 postings flushed, then deletes of 200 of them flushed as tombstones:
+//segments [1000, 200], 400 postings of garbage (the tombstones and their victims)
+static TermPack packWithGarbage() {
+    TermPack tp(0, 10, 1, 1);
+    tp.addUBPostings(uint64_t(1000));
+    tp.flush();
+    tp.addDeletes(200);
+    tp.flush();
+    return tp;
+}
+
+//above the trigger, asked to just write the new segment, the pack is compacted from the bottom
+static void compactsAboveTrigger() {
+    Settings settings = Profiles::training(SSD);
+    settings.deletes.garbageTrigger = 0.25;
+
+    TermPack tp = packWithGarbage();
+    check(tp.segments().size() == 2 && tp.garbage() == 400, "the fixture has two segments and 400 garbage");
+    check(tp.garbageRatio() > settings.deletes.garbageTrigger, "the pack is above the garbage trigger");
+    check(needsCompaction(tp, settings), "the pack needs a compaction");
+    check(consolidationOffset(tp, 1, settings) == 0, "the compaction starts at the bottom");
+
+    tp.convertSeeksToTokens(1000);
+    auto cost = consolidateTP(tp, 1, settings);
+    check(tp.segments().size() == 1, "one segment after the compaction");
+    check(tp.segments().back() == 800, "the live postings are written back");
+    check(tp.garbage() == 0 && tp.reclaimed() == 400, "the garbage is reclaimed");
+    //the new segment merges from the buffer, the old one is read
+    check(cost.reads.postings == 1000 && cost.writes.postings == 800, "the old segment is read, the live postings written");
+    check(tp.tokens() == uint64_t(1000 - minutesOf(cost, settings)), "the pack pays for the compaction");
+}
+
+//below the trigger, asked to just write the new segment, nothing is merged
+static void keepsSegmentsBelowTrigger() {
+    Settings settings = Profiles::training(SSD);
+    settings.deletes.garbageTrigger = 0.5;
+
+    TermPack tp = packWithGarbage();
+    check(!needsCompaction(tp, settings), "the pack is below the garbage trigger");
+    check(consolidationOffset(tp, 1, settings) == 1, "the offset asked for is kept");
+
+    tp.convertSeeksToTokens(1000);
+    auto cost = consolidateTP(tp, 1, settings);
+    check(tp.segments().size() == 2, "the segments stay");
+    check(tp.garbage() == 400 && tp.reclaimed() == 0, "the garbage stays below the trigger");
+    check(cost.reads.postings == 0 && cost.writes.postings == 200, "only the new segment is written");
+    check(tp.tokens() == 1000, "nothing is paid for");
+}
+
+//the advice reports the compaction consolidateTP does, not the ski-rental offset
+static void advisesCompaction() {
+    Settings settings = Profiles::training(SSD);
+    settings.deletes.garbageTrigger = 0.25;
+    settings.updateBufferPostingsLimit = 1 << 20;
+    settings.cacheSizePostings = 1 << 10;
+    Advisor advisor(settings);
+
+    advisor.onUpdates(0, 1000);
+    auto first = advisor.recommendConsolidation(0);
+    check(first.segments == 1 && !first.compaction && !first.consolidate(), "the first flush is just written");
+
+    advisor.onDeletes(0, 200);
+    auto second = advisor.recommendConsolidation(0);
+    check(second.segments == 2, "the tombstones are a second segment");
+    check(second.compaction && second.firstSegment == 0, "the advice is a compaction from the bottom");
+    check(second.consolidate(), "the advice consolidates");
+    check(second.cost.reads.postings == 1000 && second.cost.writes.postings == 800, "the advice has the compaction's cost");
+    check(advisor.pack(0).segments().size() == 1 && advisor.pack(0).reclaimed() == 400, "the pack is compacted");
+    check(!advisor.shouldEvict(), "the update buffer is empty");
+}
+
+int main() {
+    compactsAboveTrigger();
+    keepsSegmentsBelowTrigger();
+    advisesCompaction();
+    if(!failures)
+        std::cout << "SkiRental: all passed" << std::endl;
+    return failures ? 1 : 0;
+}
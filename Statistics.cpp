@@ -0,0 +1,30 @@
+#include "Statistics.h"
+
+#include <cmath>
+
+namespace IndexUpdate {
+
+    double studentT95(size_t degreesOfFreedom) {
+        static const double table[] = {
+                12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        const size_t tableSz = sizeof(table)/sizeof(table[0]);
+        if(degreesOfFreedom == 0)
+            return HUGE_VAL;
+        if(degreesOfFreedom <= tableSz)
+            return table[degreesOfFreedom-1];
+        return 1.96 + 2.4/double(degreesOfFreedom); //close enough to the tail of the table
+    }
+
+    double RunningStat::halfWidth95() const {
+        if(n < 2)
+            return HUGE_VAL;
+        return studentT95(n-1) * std::sqrt(variance() / double(n));
+    }
+
+    bool RunningStat::tight(double relPrecision) const {
+        auto hw = halfWidth95();
+        return hw <= relPrecision * std::fabs(avg);
+    }
+}
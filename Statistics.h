@@ -0,0 +1,36 @@
+#ifndef UPDATE_LITE_STATISTICS_H
+#define UPDATE_LITE_STATISTICS_H
+
+#include <cstddef>
+
+namespace IndexUpdate {
+
+    //two sided 95% quantile of Student's t
+    double studentT95(size_t degreesOfFreedom);
+
+    //running mean and variance (Welford)
+    class RunningStat {
+        size_t n;
+        double avg;
+        double m2;
+    public:
+        RunningStat() : n(0), avg(0), m2(0) {}
+
+        void add(double x) {
+            ++n;
+            double delta = x - avg;
+            avg += delta / double(n);
+            m2 += delta * (x - avg);
+        }
+
+        size_t count() const { return n; }
+        double mean() const { return avg; }
+        double variance() const { return n > 1 ? m2 / double(n-1) : 0.0; }
+        //half width of the 95% confidence interval of the mean
+        double halfWidth95() const;
+        //the interval is within relPrecision of the mean
+        bool tight(double relPrecision) const;
+    };
+}
+
+#endif //UPDATE_LITE_STATISTICS_H
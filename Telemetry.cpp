@@ -0,0 +1,106 @@
+#include "Telemetry.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace IndexUpdate {
+
+    namespace {
+        const size_t ringRecords = 1 << 12;
+        const size_t writeBatch = 256;
+        const unsigned maxIdleMs = 64; //the writer sleeps longer while there is nothing to write
+    }
+
+    unsigned TelemetryRecord::bucketOf(size_t segments) {
+        unsigned bucket = 0;
+        for(size_t limit = 1; segments > limit && bucket + 1 < segmentBuckets; limit <<= 1)
+            ++bucket;
+        return bucket;
+    }
+
+    TelemetryHeader TelemetryHeader::current() {
+        TelemetryHeader header;
+        std::memcpy(header.magic, "ULTM", 4);
+        header.version = 1;
+        header.recordBytes = sizeof(TelemetryRecord);
+        header.reserved = 0;
+        return header;
+    }
+
+    bool TelemetryHeader::valid() const {
+        const TelemetryHeader expected = current();
+        return !std::memcmp(magic, expected.magic, 4) && version == expected.version &&
+               recordBytes == expected.recordBytes;
+    }
+
+    TelemetryWriter::TelemetryWriter(const std::string& path) :
+            ring(ringRecords), file(std::fopen(path.c_str(), "wb")), stopping(false),
+            pushed(0), stalls(0), filePath(path) {
+        if(!file)
+            throw std::runtime_error("cannot write the telemetry file " + path);
+        const TelemetryHeader header = TelemetryHeader::current();
+        std::fwrite(&header, sizeof(header), 1, file);
+        writer = std::thread([this]() { drain(); });
+    }
+
+    TelemetryWriter::~TelemetryWriter() {
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+        std::fclose(file);
+    }
+
+    void TelemetryWriter::drain() {
+        std::vector<TelemetryRecord> batch(writeBatch);
+        unsigned idleMs = 1;
+        for(;;) {
+            //whatever was pushed before the stop is in the ring by now
+            const bool last = stopping.load(std::memory_order_acquire);
+            const size_t n = ring.pop(batch.data(), batch.size());
+            if(n) {
+                std::fwrite(batch.data(), sizeof(TelemetryRecord), n, file);
+                idleMs = 1;
+                continue;
+            }
+            if(last)
+                return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+            idleMs = std::min(2 * idleMs, maxIdleMs);
+        }
+    }
+
+    void TelemetryWriter::push(const TelemetryRecord& record) {
+        ++pushed;
+        if(ring.push(record))
+            return;
+        ++stalls;
+        while(!ring.push(record))
+            std::this_thread::yield();
+    }
+
+    void TelemetryWriter::report(std::ostream& out) const {
+        out << " Telemetry: records: " << pushed << " stalls: " << stalls << " file: " << filePath;
+    }
+
+    bool readTelemetry(std::istream& in, std::vector<TelemetryRecord>& records) {
+        TelemetryHeader header;
+        if(!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !header.valid())
+            return false;
+        TelemetryRecord record;
+        while(in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+            records.push_back(record);
+        return in.gcount() == 0; //no partial record at the end
+    }
+
+    void writeCsv(std::ostream& out, const std::vector<TelemetryRecord>& records) {
+        out << "evictions,postings,queries,clock_ms,query_minutes,merge_minutes,buffer_fill,hit_pct,tokens,"
+               "seg_le1,seg_2,seg_le4,seg_le8,seg_le16,seg_le32,seg_le64,seg_more\n";
+        for(const auto& r : records) {
+            out << r.evictions << ',' << r.postings << ',' << r.queries << ',' << r.clockMs << ',' <<
+                r.queryMinutes << ',' << r.mergeMinutes << ',' << r.bufferFill << ',' << r.hitPct << ',' << r.tokens;
+            for(auto count : r.segments)
+                out << ',' << count;
+            out << '\n';
+        }
+    }
+}
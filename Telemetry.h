@@ -0,0 +1,105 @@
+#ifndef UPDATE_LITE_TELEMETRY_H
+#define UPDATE_LITE_TELEMETRY_H
+
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace IndexUpdate {
+
+    //one sample of a run (Settings::telemetry), cumulative since its start.
+    //Fixed size and layout: the files are these records after a TelemetryHeader
+    struct TelemetryRecord {
+        static const unsigned segmentBuckets = 8;
+
+        uint64_t evictions;
+        uint64_t postings; //of the update stream, on disk and buffered
+        uint64_t queries;
+        double clockMs; //simulated
+        double queryMinutes;
+        double mergeMinutes;
+        double bufferFill; //of the update buffer (its current limit)
+        double hitPct;
+        double tokens; //the ski rental's, over all the packs
+        //packs by their segments: <=1, 2, <=4, <=8, <=16, <=32, <=64, more
+        uint32_t segments[segmentBuckets];
+
+        static unsigned bucketOf(size_t segments);
+    };
+
+    struct TelemetryHeader {
+        char magic[4]; //ULTM
+        uint32_t version;
+        uint32_t recordBytes;
+        uint32_t reserved;
+
+        static TelemetryHeader current();
+        bool valid() const;
+    };
+
+    //single producer, single consumer: push and pop never block each other
+    template<typename T>
+    class SpscRing {
+        std::vector<T> slots;
+        size_t mask;
+        std::atomic<size_t> head; //next to pop, the consumer's
+        std::atomic<size_t> tail; //next to push, the producer's
+    public:
+        explicit SpscRing(size_t capacityPow2) : slots(capacityPow2), mask(capacityPow2 - 1), head(0), tail(0) {}
+
+        bool push(const T& value) {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if(t - head.load(std::memory_order_acquire) > mask)
+                return false; //full
+            slots[t & mask] = value;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+        //up to max values into out; returns how many
+        size_t pop(T* out, size_t max) {
+            const size_t h = head.load(std::memory_order_relaxed);
+            const size_t n = std::min(max, tail.load(std::memory_order_acquire) - h);
+            for(size_t i = 0; i < n; ++i)
+                out[i] = slots[(h + i) & mask];
+            head.store(h + n, std::memory_order_release);
+            return n;
+        }
+    };
+
+    //a telemetry file: the simulator pushes the records into a ring, a thread of the writer
+    //moves them to the file. A full ring makes the simulator wait (counted as a stall)
+    class TelemetryWriter {
+        SpscRing<TelemetryRecord> ring;
+        std::FILE* file;
+        std::thread writer;
+        std::atomic<bool> stopping;
+        uint64_t pushed;
+        uint64_t stalls;
+        std::string filePath;
+
+        void drain();
+    public:
+        //throws std::runtime_error if path cannot be written
+        explicit TelemetryWriter(const std::string& path);
+        ~TelemetryWriter(); //writes what is left and closes the file
+
+        TelemetryWriter(const TelemetryWriter&) = delete;
+        TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+        void push(const TelemetryRecord& record);
+
+        void report(std::ostream& out) const;
+    };
+
+    //reads a telemetry file back (false: not one, or truncated)
+    bool readTelemetry(std::istream& in, std::vector<TelemetryRecord>& records);
+    void writeCsv(std::ostream& out, const std::vector<TelemetryRecord>& records);
+}
+
+#endif //UPDATE_LITE_TELEMETRY_H
@@ -0,0 +1,27 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+
+#include "Telemetry.h"
+
+using namespace IndexUpdate;
+
+//converts telemetry files (Settings::telemetry) to CSV on stdout
+int main(int argc, char** argv) {
+    if(argc != 2) {
+        std::cerr << "usage: " << argv[0] << " telemetry-file\n";
+        return 1;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    std::vector<TelemetryRecord> records;
+    const bool whole = in && readTelemetry(in, records);
+    if(records.empty() && !whole) {
+        std::cerr << "not a telemetry file: " << argv[1] << std::endl;
+        return 1;
+    }
+    if(!whole) //a run that did not finish
+        std::cerr << "truncated after " << records.size() << " records: " << argv[1] << std::endl;
+    std::cout << std::setprecision(12);
+    writeCsv(std::cout, records);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "TermPack.h"
 
 #include <algorithm>
+#include <cmath>
 
 namespace IndexUpdate {
 
@@ -17,4 +18,51 @@ namespace IndexUpdate {
         for(auto& tp : tpacks)
             tp.tpNormalizedUpdates = round(double(tp.tpEpochUpdates)/div);
     }
+
+    uint64_t TermPack::addDeletes(double deletes) {
+        tpDeleteCarry += deletes;
+        const auto victims = uint64_t(tpDeleteCarry);
+        tpDeleteCarry -= victims;
+        if(!victims)
+            return 0;
+        const uint64_t bufferedLive = tpUBPostings - tpUBDropped;
+        const uint64_t diskLive = tpDiskPostings - tpGarbage - tpUBTombstones;
+        if(!bufferedLive && !diskLive)
+            return 0;
+        const auto buffered = std::min(bufferedLive, uint64_t(std::llround(
+                double(victims) * double(bufferedLive) / double(bufferedLive + diskLive))));
+        const auto tombstones = std::min(diskLive, victims - buffered);
+        tpUBDropped += buffered;
+        tpUBTombstones += tombstones;
+        return tombstones;
+    }
+
+    uint64_t TermPack::reclaim(double share, bool bottom) {
+        const auto dead = tpGarbage - tpTombstones;
+        const auto deadGone = bottom ? dead : std::min(dead, uint64_t(std::llround(double(dead) * share)));
+        const auto tombstonesGone = bottom ? tpTombstones : 0;
+        const auto gone = deadGone + tombstonesGone;
+        tpGarbage -= gone;
+        tpTombstones -= tombstonesGone;
+        tpDiskPostings -= gone;
+        tpReclaimed += gone;
+        return gone;
+    }
+
+    double TermPack::expectedProbes() const {
+        double probes = 0;
+        for(auto segment : tpSegments) {
+            const double p = presence(segment);
+            probes += p + (1-p) * tpFalsePositive;
+        }
+        //the segments still being merged in the background count as the mean one
+        return probes * double(tpSegments.size() + tpUnmergedSegments) / double(tpSegments.size());
+    }
+
+    double TermPack::filterKeys() const {
+        double keys = 0;
+        for(auto segment : tpSegments)
+            keys += presence(segment) * tpMembersCount;
+        return keys;
+    }
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <vector>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 #include "Consolidation.h"
 
@@ -15,21 +17,43 @@ namespace IndexUpdate {
         uint64_t tpEpochUpdates;
         uint64_t tpEpochQueries;
         uint64_t tpNormalizedUpdates;
+        double tpUpdateCarry; //of addWeightedUBPostings
 
         uint64_t tpUBPostings;
         uint64_t tpEvictedPostings;
 
+        //deletes (and updates in place, a delete and an append): a buffered victim is dropped
+        //before its flush, one on disk gets a tombstone that is flushed like a posting.
+        //On disk, the dead postings and the tombstones are garbage until a merge reclaims them
+        uint64_t tpUBDropped;
+        uint64_t tpUBTombstones;
+        double tpDeleteCarry;
+        uint64_t tpDiskPostings; //in the segments, garbage included
+        uint64_t tpGarbage;
+        uint64_t tpTombstones; //of tpGarbage
+        uint64_t tpReclaimed;
+
         uint64_t tpExtraSeeks;
         uint64_t tpTokens;
+        uint64_t tpDiskQueries;
 
-        std::vector<uint64_t> tpSegments;
+        SegmentStack tpSegments;
+        //consolidated away in tpSegments, but their background merge has not finished yet
+        unsigned tpUnmergedSegments;
+        //of the per-segment membership filters (1: no filters, every segment is probed)
+        double tpFalsePositive;
+        double tpProbeCarry; //the fraction of an expected probe not charged yet
 
     public:
         TermPack(unsigned id=0, unsigned members=0, uint64_t upd=0, uint64_t qs=0 )
                 : tpId(id),tpMembersCount(members),
-                  tpEpochUpdates(upd),tpEpochQueries(qs),
+                  tpEpochUpdates(upd),tpEpochQueries(qs),tpNormalizedUpdates(0),tpUpdateCarry(0),
                   tpUBPostings(0), tpEvictedPostings(0),
-                  tpExtraSeeks(0),tpTokens(0.0)
+                  tpUBDropped(0), tpUBTombstones(0), tpDeleteCarry(0),
+                  tpDiskPostings(0), tpGarbage(0), tpTombstones(0), tpReclaimed(0),
+                  tpExtraSeeks(0),tpTokens(0.0),tpDiskQueries(0),
+                  tpUnmergedSegments(0),
+                  tpFalsePositive(1), tpProbeCarry(0)
         {}
 
         uint64_t addUBPostings() {
@@ -38,35 +62,112 @@ namespace IndexUpdate {
             return tpNormalizedUpdates;
         }
 
-        uint64_t evictAll() {
-            auto evicted = tpUBPostings;
-            tpEvictedPostings += evicted;
-            tpUBPostings = 0;
-            return evicted;
+        //the normalized updates times the pack's weight in the current update mix
+        uint64_t addWeightedUBPostings(double weight) {
+            tpUpdateCarry += weight * double(tpNormalizedUpdates);
+            const auto added = uint64_t(tpUpdateCarry);
+            tpUpdateCarry -= double(added);
+            tpUBPostings += added;
+            return added;
+        }
+
+        //postings of a live update stream (no normalization)
+        void addUBPostings(uint64_t postings) { tpUBPostings += postings; }
+        uint64_t bufferedPostings() const { return tpUBPostings; }
+        uint64_t receivedPostings() const { return tpEvictedPostings + tpUBPostings; }
+
+        //the buffered tombstones (or dropped postings) that go with the first postings of the buffer
+        uint64_t shareOf(uint64_t buffered, uint64_t postings) const {
+            return postings >= tpUBPostings ? buffered :
+                   uint64_t(double(buffered) * double(postings) / double(tpUBPostings));
+        }
+        //what flush(limit) takes out of the buffer: postings and tombstones
+        uint64_t flushLoad(uint64_t limit) const {
+            const auto postings = std::min(limit, tpUBPostings);
+            return postings + shareOf(tpUBTombstones, postings);
+        }
+
+        //evicts (up to limit postings of) the buffer into a new segment: its postings, but the dropped
+        //ones, and its tombstones; a partial flush takes their share. returns the postings it evicted
+        uint64_t flush(uint64_t limit = UINT64_MAX) {
+            const auto postings = std::min(limit, tpUBPostings);
+            const auto dropped = shareOf(tpUBDropped, postings);
+            const auto tombstones = shareOf(tpUBTombstones, postings);
+            const auto written = postings - dropped + tombstones;
+            tpSegments.push_back(written);
+            tpDiskPostings += written;
+            tpGarbage += 2 * tombstones; //the tombstones and their victims
+            tpTombstones += tombstones;
+            tpUBDropped -= dropped;
+            tpUBTombstones -= tombstones;
+            tpUBPostings -= postings;
+            tpEvictedPostings += postings;
+            return postings;
+        }
+
+        //deletes of that many (expected) live postings, the victims picked evenly among them;
+        //returns the tombstones it added to the buffer
+        uint64_t addDeletes(double deletes);
+        uint64_t bufferedTombstones() const { return tpUBTombstones; }
+        uint64_t diskPostings() const { return tpDiskPostings; }
+        uint64_t garbage() const { return tpGarbage; }
+        uint64_t reclaimed() const { return tpReclaimed; }
+        double garbageRatio() const { return tpDiskPostings ? double(tpGarbage) / double(tpDiskPostings) : 0.0; }
+
+        //a merge rewrote share of the postings on disk: the dead postings among them are gone,
+        //the tombstones only if it went down to the oldest segment (no older victim can be left).
+        //returns how many postings it reclaimed
+        uint64_t reclaim(double share, bool bottom);
+
+        SegmentStack& unsafeGetSegments() { return tpSegments; }
+        const SegmentStack& segments() const { return tpSegments; }
+
+        void addUnmerged(int segments) {
+            assert(int(tpUnmergedSegments) + segments >= 0);
+            tpUnmergedSegments += segments;
         }
+        unsigned unmerged() const { return tpUnmergedSegments; }
 
-        std::vector<uint64_t>& unsafeGetSegments() { return tpSegments; }
-        const std::vector<uint64_t>& segments() const { return tpSegments; }
+        void setFilters(double falsePositive) { tpFalsePositive = falsePositive; }
+        //the expected share of the members that got postings in a segment of that size
+        double presence(uint64_t segment) const { return 1.0 - std::exp(-double(segment) / tpMembersCount); }
+        //the segments a query probes: those holding the term and the false positives of the others
+        double expectedProbes() const;
+        //the distinct terms of all the segments, the keys of their filters
+        double filterKeys() const;
 
+        unsigned id() const { return tpId; }
         uint64_t updates() const { return tpEpochUpdates; }
         uint64_t members() const { return tpMembersCount; }
 
         uint64_t extraSeeks() const { return  tpExtraSeeks; }
+        uint64_t tokens() const { return tpTokens; }
+        uint64_t diskQueries() const { return tpDiskQueries; }
         double convertSeeksToTokens(double tokens) {
             tpExtraSeeks = 0;
             tpTokens += tokens;
             return tpTokens;
         }
-        void reduceTokens(double tokens) { tpTokens -= tokens;}
+        void reduceTokens(double tokens) { tpTokens -= std::min(tokens, double(tpTokens)); }
 
         ReadIO query() {
+            ++tpDiskQueries;
             if(tpSegments.empty()) //what do you know, no evictions
                 return ReadIO(0,0);
-            tpExtraSeeks += tpSegments.size()-1;
-            return ReadIO(meanDiskLength(), tpSegments.size());
+            uint64_t probes = tpSegments.size() + tpUnmergedSegments;
+            if(tpFalsePositive < 1) { //the filters skip most of the segments without the term
+                tpProbeCarry += expectedProbes();
+                probes = uint64_t(tpProbeCarry);
+                tpProbeCarry -= probes;
+            }
+            tpExtraSeeks += probes ? probes-1 : 0;
+            return ReadIO(meanDiskLength(), probes);
         };
 
-        uint64_t  meanDiskLength() const { return tpEvictedPostings/tpMembersCount; }
+        //the postings of a term a query reads, garbage included
+        uint64_t  meanDiskLength() const { return tpDiskPostings/tpMembersCount; }
+        //...and those it keeps
+        uint64_t  liveDiskLength() const { return (tpDiskPostings - tpGarbage)/tpMembersCount; }
 
         static void normalizeUpdates(std::vector<TermPack> &tpacks, double reduceTo = 1<<14);
     };
@@ -0,0 +1,61 @@
+#include "ThreadPool.h"
+
+namespace IndexUpdate {
+
+    ThreadPool::ThreadPool(unsigned threads) :
+            job(nullptr), jobSize(0), next(0), generation(0), pending(0), stopping(false) {
+        for(unsigned i = 1; i < threads; ++i)
+            workers.emplace_back(&ThreadPool::work, this);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(auto& w : workers)
+            w.join();
+    }
+
+    void ThreadPool::work() {
+        uint64_t seen = 0;
+        for(;;) {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if(stopping)
+                return;
+            seen = generation;
+            const auto& f = *job;
+            const auto n = jobSize;
+            lock.unlock();
+
+            drain(f, n);
+
+            lock.lock();
+            if(--pending == 0)
+                done.notify_all();
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& f) {
+        if(workers.empty() || n < 2) {
+            for(size_t i = 0; i < n; ++i)
+                f(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            job = &f;
+            jobSize = n;
+            next = 0;
+            pending = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        drain(f, n);
+        //every worker checks in, so none of them is left holding this job
+        std::unique_lock<std::mutex> lock(mtx);
+        done.wait(lock, [&] { return pending == 0; });
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef UPDATE_LITE_THREADPOOL_H
+#define UPDATE_LITE_THREADPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace IndexUpdate {
+
+    //a fixed set of workers for fork-join loops: parallelFor(n, f) calls f(0)..f(n-1)
+    //(the calling thread helps) and returns when all of them are done.
+    //f must not throw.
+    class ThreadPool {
+        std::vector<std::thread> workers;
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        const std::function<void(size_t)>* job;
+        size_t jobSize;
+        std::atomic<size_t> next;
+        uint64_t generation;
+        size_t pending; //workers still on the current generation
+        bool stopping;
+
+        void drain(const std::function<void(size_t)>& f, size_t n) {
+            for(size_t i; (i = next.fetch_add(1)) < n; )
+                f(i);
+        }
+        void work();
+    public:
+        //threads counts the caller, so threads-1 workers are started
+        explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        unsigned size() const { return unsigned(workers.size()) + 1; }
+
+        void parallelFor(size_t n, const std::function<void(size_t)>& f);
+    };
+}
+
+#endif //UPDATE_LITE_THREADPOOL_H
@@ -0,0 +1,120 @@
+#include "Workload.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace IndexUpdate {
+
+    double WorkloadClock::Cumulative::at(double ms) const {
+        if(std::isinf(ms))
+            return ms;
+        double periods = 0, r = ms;
+        if(periodMs > 0) {
+            periods = std::floor(ms / periodMs);
+            r = std::max(ms - periods * periodMs, 0.0);
+        }
+        const size_t i = size_t(std::upper_bound(startMs.begin(), startMs.end(), r) - startMs.begin()) - 1;
+        return periods * perPeriod + atStart[i] + (r - startMs[i]) * slope[i];
+    }
+
+    double WorkloadClock::Cumulative::inverse(double value) const {
+        if(std::isinf(value))
+            return value;
+        double periods = 0, r = value;
+        if(periodMs > 0) {
+            periods = std::floor(value / perPeriod);
+            r = std::max(value - periods * perPeriod, 0.0);
+        }
+        const size_t i = size_t(std::upper_bound(atStart.begin(), atStart.end(), r) - atStart.begin()) - 1;
+        const double offset = slope[i] > 0 ? (r - atStart[i]) / slope[i] : 0.0;
+        return periods * periodMs + startMs[i] + offset;
+    }
+
+    WorkloadClock::WorkloadClock() : ingestPerSec(1e5), postingsPerMs(100), queriesPerMs(0) {}
+
+    void WorkloadClock::init(const Settings& settings) {
+        ingestPerSec = settings.device.ingestPostingsPerSec;
+        postingsPerMs = ingestPerSec / 1000.0;
+        queriesPerMs = postingsPerMs * double(settings.quieriesQuant) / double(settings.updatesQuant);
+        pieces = settings.workload.pieces;
+        packMixes.clear();
+        postings = queries = Cumulative();
+        if(pieces.empty())
+            return;
+
+        const double periodMs = settings.workload.periodSec * 1000.0;
+        if(pieces.front().startSec != 0)
+            throw std::runtime_error("the first piece of a workload profile must start at 0");
+        for(size_t i = 0; i < pieces.size(); ++i) {
+            const auto& p = pieces[i];
+            if(i && p.startSec <= pieces[i-1].startSec)
+                throw std::runtime_error("the pieces of a workload profile must start in order");
+            if(periodMs > 0 && p.startSec * 1000.0 >= periodMs)
+                throw std::runtime_error("a piece of a workload profile starts after its period");
+            if(p.updateRate < 0 || p.queryRate < 0)
+                throw std::runtime_error("negative rate in a workload profile");
+
+            packMixes.emplace_back();
+            if(p.packUpdates.empty())
+                continue;
+            auto& mix = packMixes.back();
+            mix.assign(settings.tpUpdates.size(), 1.0);
+            for(const auto& weight : p.packUpdates) {
+                if(weight.first >= mix.size() || weight.second < 0)
+                    throw std::runtime_error("bad pack weight in a workload profile: " +
+                                             std::to_string(weight.first));
+                mix[weight.first] = weight.second;
+            }
+            if(*std::max_element(mix.begin(), mix.end()) <= 0)
+                throw std::runtime_error("a piece of a workload profile updates no pack");
+        }
+
+        for(auto* f : {&postings, &queries}) {
+            f->periodMs = periodMs;
+            double value = 0;
+            for(size_t i = 0; i < pieces.size(); ++i) {
+                const auto& p = pieces[i];
+                f->startMs.push_back(p.startSec * 1000.0);
+                f->atStart.push_back(value);
+                f->slope.push_back(f == &postings ? postingsPerMs * p.updateRate : queriesPerMs * p.queryRate);
+                if(periodMs > 0) {
+                    const double endMs = i + 1 < pieces.size() ? pieces[i+1].startSec * 1000.0 : periodMs;
+                    value += (endMs - f->startMs.back()) * f->slope.back();
+                }
+                else if(i + 1 < pieces.size())
+                    value += (pieces[i+1].startSec - p.startSec) * 1000.0 * f->slope.back();
+            }
+            f->perPeriod = periodMs > 0 ? value : 0;
+        }
+        if(periodMs > 0 ? postings.perPeriod <= 0 : postings.slope.back() <= 0)
+            throw std::runtime_error("the postings stream of the workload profile stops");
+    }
+
+    size_t WorkloadClock::piece(double ms) const {
+        double r = ms;
+        if(postings.periodMs > 0 && !std::isinf(ms))
+            r = std::max(ms - std::floor(ms / postings.periodMs) * postings.periodMs, 0.0);
+        return size_t(std::upper_bound(postings.startMs.begin(), postings.startMs.end(), r) -
+                      postings.startMs.begin()) - 1;
+    }
+
+    const std::vector<double>& WorkloadClock::packMix(double ms) const {
+        static const std::vector<double> asIs;
+        return enabled() ? packMixes[piece(ms)] : asIs;
+    }
+
+    double WorkloadClock::postingsToMs(uint64_t stream) const {
+        if(!enabled()) //IOTimeline::postingsToMs
+            return double(stream) / ingestPerSec * 1000.0;
+        return postings.inverse(double(stream));
+    }
+
+    double WorkloadClock::msToPostings(double ms) const {
+        if(!enabled())
+            return ms / 1000.0 * ingestPerSec;
+        return postings.at(ms);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef UPDATE_LITE_WORKLOAD_H
+#define UPDATE_LITE_WORKLOAD_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Settings.h"
+
+namespace IndexUpdate {
+
+    //the simulated clock under Settings::workload: the postings stream and the queries advance
+    //at the rates of the piece of the profile at hand. Without a profile the rates are constant
+    //and the clock is IOTimeline::postingsToMs
+    class WorkloadClock {
+        //a piecewise linear nondecreasing function of the time in ms, repeating every periodMs
+        struct Cumulative {
+            std::vector<double> startMs;
+            std::vector<double> atStart;
+            std::vector<double> slope; //per ms
+            double periodMs;
+            double perPeriod;
+
+            double at(double ms) const;
+            //the time the function reaches value (after the pieces where it stays flat)
+            double inverse(double value) const;
+        };
+
+        double ingestPerSec; //DeviceModel::ingestPostingsPerSec
+        double postingsPerMs;
+        double queriesPerMs; //what the quants set at that ingest rate
+        std::vector<WorkloadPiece> pieces;
+        std::vector<std::vector<double> > packMixes; //per piece, empty: tpUpdates as is
+        Cumulative postings;
+        Cumulative queries;
+
+        size_t piece(double ms) const;
+    public:
+        WorkloadClock();
+
+        //throws std::runtime_error if the profile cannot drive the run
+        void init(const Settings& settings);
+        bool enabled() const { return !pieces.empty(); }
+
+        double postingsToMs(uint64_t stream) const;
+        double msToPostings(double ms) const;
+
+        //queries asked since the start at ms (fractional)
+        double queriesAt(double ms) const { return queries.at(ms); }
+        //when the queries asked reach count
+        double queryMs(double count) const { return queries.inverse(count); }
+        double qps(double ms) const { return queriesPerMs * 1000.0 * pieces[piece(ms)].queryRate; }
+
+        size_t size() const { return pieces.size(); }
+        size_t pieceAt(double ms) const { return piece(ms); }
+        //below the rate of the quants
+        bool offPeak(size_t i) const { return pieces[i].queryRate < 1; }
+        //the weights of the packs in the update mix at ms (empty: their tpUpdates)
+        const std::vector<double>& packMix(double ms) const;
+    };
+}
+
+#endif //UPDATE_LITE_WORKLOAD_H
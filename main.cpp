@@ -2,8 +2,12 @@
 #include <iostream>
 #include <future>
 #include <cassert>
+#include <cstring>
+#include <cstdlib>
 
 #include "Simulator.h"
+#include "Profiles.h"
+#include "Workload.h"
 
 
 using namespace IndexUpdate;
@@ -13,17 +17,117 @@ IndexUpdate::Settings setup(IndexUpdate::DiskType disk = IndexUpdate::HD, unsign
 void experiment(IndexUpdate::DiskType disk, unsigned queries);
 void findOptimal(IndexUpdate::DiskType disk, unsigned queries);
 
-uint64_t globalOpts[16] = {0};
+uint64_t globalOpts[64] = {0};
+std::string workloadFile;
+std::string telemetryPrefix;
+std::string cacheSavePrefix;
+std::string cacheLoadPrefix;
 enum names {
     gTotalMPostings,
-    gQRate
+    gQRate,
+    gSketchTerms,
+    gQueryStream,
+    gReplicas,
+    gReplicaPermille,
+    gTimeline,
+    gChannels,
+    gQueueDepth,
+    gIngestRate,
+    gBackground,
+    gMergeMBS,
+    gDeferQps,
+    gMaxDeferSec,
+    gShards,
+    gAdaptiveMemory,
+    gMemoryStepPermille,
+    gEvictionOrder,
+    gPackPolicyPeriod,
+    gFilterBits,
+    gCodec,
+    gTierMPostings,
+    gTierInclusive,
+    gDeletesPermille,
+    gGarbageTriggerPct,
+    gPackThreads,
+    gTelemetryQueries,
+    gMemoryReport,
+    gFlushKPostings,
+    gMergeMemory,
+    gMergeStreams,
+    gMergeFromCache,
+    gCoherence
 };
 
+//optional name=value arguments, may follow the positional ones
+const std::pair<const char*, names> namedOpts[] = {
+        {"sketch", gSketchTerms}, //TinyLFU cache admission sized for that many terms (0: ghost entries)
+        {"stream", gQueryStream}, //random query order from this stream (0: round robin)
+        {"replicas", gReplicas}, //at most that many Monte Carlo replicas (0: single run), not with shards
+        {"precision", gReplicaPermille}, //replicas stop once the 95% CIs are within that many permille of the means
+        {"timeline", gTimeline}, //1: queue-depth aware device on a simulated I/O timeline
+        {"channels", gChannels}, //SSD channels of the timeline (0: the profile's; HD has one head)
+        {"qd", gQueueDepth}, //SSD queue depth (0: the profile's)
+        {"ingest", gIngestRate}, //postings per second, maps the update stream onto time (0: 100K/s)
+        {"background", gBackground}, //1: merges run in the background, queries see the unmerged segments meanwhile
+        {"mergembs", gMergeMBS}, //bandwidth budget of the background merges (0: all of it)
+        {"deferqps", gDeferQps}, //background merges wait while the query rate is above that (0: never)
+        {"maxdefer", gMaxDeferSec}, //...for at most that many seconds (0: 600)
+        {"shards", gShards}, //>1: the budgets are split over a cluster of that many nodes
+        {"adaptive", gAdaptiveMemory}, //1: memory moves between the update buffer and the cache online
+        {"memstep", gMemoryStepPermille}, //permille of the memory moved at a time (0: 10)
+        {"evictorder", gEvictionOrder}, //ski rental flushes 0: larger pack ids first, 1: by benefit per I/O minute
+        {"hybrid", gPackPolicyPeriod}, //ski rental: each pack picks never/log/ski merges, again every that many evictions
+        {"filterbits", gFilterBits}, //per-TermPack algorithms: Bloom filters of that many bits per term on every segment
+        {"codec", gCodec}, //postings stored 0: fixed size, 1: varbyte, 2: bit packed (I/O, cache and CPU costs)
+        {"coherence", gCoherence}, //cached terms of flushed/merged packs: 0 patched on hits, 1 invalidated, 2 refreshed
+        {"tier", gTierMPostings}, //millions of postings of an SSD cache tier under the cache (0: none)
+        {"tierinclusive", gTierInclusive}, //1: the tier is filled by the misses of the cache, 0: by its victims
+        {"deletes", gDeletesPermille}, //deletes (or updates in place) per thousand ingested postings
+        {"garbage", gGarbageTriggerPct}, //a pack (or index) with more than that % of garbage on disk is compacted (0: never)
+        {"threads", gPackThreads}, //>1: the packs of an eviction are flushed and merged on that many threads
+        {"telemetryq", gTelemetryQueries}, //a telemetry record every that many queries (0: every eviction)
+        {"memreport", gMemoryReport}, //1: the reports end with the memory by subsystem and the peak RSS
+        {"mergemem", gMergeMemory}, //memory of the merges in Mi postings (0: 64)
+        {"mergestreams", gMergeStreams}, //merges running at once, sharing the memory and the device (0: 1)
+        {"mergefromcache", gMergeFromCache}, //1: the merge memory is taken from the cache
+        {"flushk", gFlushKPostings}, //per-TermPack algorithms: packs flush the room needed in multiples of that many K postings (0: all)
+};
+//the options whose value is a path
+const std::pair<const char*, std::string*> pathOpts[] = {
+        {"profile", &workloadFile}, //time-varying rates (see Profiles::workload)
+        {"telemetry", &telemetryPrefix}, //per-run time series of the costs: <prefix>-<run>.tlm (update_lite_telemetry2csv)
+        {"cachesave", &cacheSavePrefix}, //every run saves the cache it ends with: <prefix>-<run>.ulcs
+        {"cacheload", &cacheLoadPrefix}, //every run starts with the cache saved as <prefix>-<run>.ulcs
+};
+
+//returns false if arg is not a known name=value
+bool parseNamed(const std::string& arg) {
+    auto eq = arg.find('=');
+    if(eq == std::string::npos)
+        return false;
+    for(const auto& opt : pathOpts)
+        if(arg.compare(0, eq, opt.first) == 0 && eq == strlen(opt.first)) {
+            *opt.second = arg.substr(eq+1);
+            return true;
+        }
+    for(const auto& opt : namedOpts)
+        if(arg.compare(0, eq, opt.first) == 0 && eq == strlen(opt.first)) {
+            globalOpts[opt.second] = strtoull(arg.c_str()+eq+1, nullptr, 10);
+            return true;
+        }
+    std::cerr << "unknown option: " << arg << std::endl;
+    exit(1);
+}
+
 int main(int argc, char** argv) {
     std::cout.imbue(std::locale(""));
-    if(argc >= 2) {
-        globalOpts[gQRate] = atoi(argv[1]);
-        globalOpts[gTotalMPostings] = (argc >= 3) ? 1000ull*1000ull*atoi(argv[2]) :  64ull*1000*1000*1000;
+    std::vector<char*> positional;
+    for(int i = 1; i < argc; ++i)
+        if(!parseNamed(argv[i]))
+            positional.push_back(argv[i]);
+    if(positional.size() >= 1) {
+        globalOpts[gQRate] = atoi(positional[0]);
+        globalOpts[gTotalMPostings] = (positional.size() >= 2) ? 1000ull*1000ull*atoi(positional[1]) :  64ull*1000*1000*1000;
         for (auto queries : {globalOpts[gQRate]}) {
             std::cout << "===== > " << queries << " HD...\n";
             experiment(HD, queries);
@@ -34,7 +138,7 @@ int main(int argc, char** argv) {
         }
     }
     else {
-        std::cout << "usage: " << argv[0] << " query-rate(>=1)\n";
+        std::cout << "usage: " << argv[0] << " query-rate(>=1) [total-M-postings] [name=value...]\n";
 //        assert(argc==3);
 //        auto queries = atoi(argv[1]);
 //        std::string disk(argv[2]);
@@ -48,7 +152,7 @@ int main(int argc, char** argv) {
 void experiment(IndexUpdate::DiskType disk, unsigned queries){
     Settings settings = setup(disk,queries);
 
-    std::vector<Algorithm> ski {SkiBased};
+    std::vector<Algorithm> ski {SkiBased, Prognosticator};
     std::vector<Algorithm> log { LogMerge};
     std::vector<Algorithm> alw { AlwaysMerge};
 
@@ -100,94 +204,63 @@ void experiment(IndexUpdate::DiskType disk, unsigned queries){
 
 
 IndexUpdate::Settings setup(IndexUpdate::DiskType disk, unsigned queriesQuant ) {
-    IndexUpdate::Settings sets;
-    sets.diskType = disk;
-    if(IndexUpdate::HD == disk) {
-        sets.ioMBS = 150; //how many MB per second we can read/write
-        sets.ioSeek = 7; //the time to make an average seek (random access latency)
-    }
-    else if (IndexUpdate::SSD == disk){ //from Samsung
-        sets.ioMBS = 500; //how many MB per second we can read/write
-        sets.ioSeek = 0.0625; //the time to make an average seek (random access latency)
-    }
-    sets.quieriesQuant = queriesQuant;
-
-    sets.szOfPostingBytes = 4; //we use fixed size of postings (in bytes).
+    IndexUpdate::Settings sets = Profiles::training(disk, queriesQuant);
     sets.totalExperimentPostings = globalOpts[gTotalMPostings];
-    sets.updatesQuant = 1000*1000;
-    sets.percentsUBLeft = 25;
-
-    if(IndexUpdate::HD == disk) {
-        //for HD
-        sets.tpMembers = {
-                21,35,50,69,
-                88,109,139,173,
-                213,261,323,401,
-                489,618,838,1206,
-                1776,3208,8213,33396,
-                2262672
-        };
-        //64
-        sets.tpQueries = {
-                24121,23619,23471,23490,
-                23739,23537,23909,23436,
-                23638,23529,23558,23565,
-                23465,23798,23885,23591,
-                23550,23559,23513,23700,
-                23826};
-
-        sets.tpUpdates = {
-                424141246,422228256,420319852,419876347,
-                423493286,419725298,421212817,420285949,
-                421057945,420528111,420271342,419493211,
-                420077546,419777985,419348858,419560157,
-                419308877,419278178,419272221,419296846,
-                419312938,
-        };
+    sets.cacheSketchTerms = globalOpts[gSketchTerms];
+    sets.queryStream = globalOpts[gQueryStream];
+    sets.replicas = globalOpts[gReplicas];
+    if(globalOpts[gReplicaPermille])
+        sets.replicaPrecision = globalOpts[gReplicaPermille] / 1000.0;
+    sets.device.timeline = globalOpts[gTimeline] != 0;
+    if(SSD == disk && globalOpts[gChannels])
+        sets.device.channels = globalOpts[gChannels];
+    if(SSD == disk && globalOpts[gQueueDepth])
+        sets.device.queueDepth = globalOpts[gQueueDepth];
+    if(globalOpts[gIngestRate])
+        sets.device.ingestPostingsPerSec = globalOpts[gIngestRate];
+    sets.merging.background = globalOpts[gBackground] != 0;
+    sets.merging.budgetMBS = globalOpts[gMergeMBS];
+    sets.merging.deferAboveQps = globalOpts[gDeferQps];
+    if(globalOpts[gMaxDeferSec])
+        sets.merging.maxDeferSec = globalOpts[gMaxDeferSec];
+    if(globalOpts[gMergeMemory])
+        sets.mergeMemory.postings = globalOpts[gMergeMemory] << 20;
+    if(globalOpts[gMergeStreams])
+        sets.mergeMemory.streams = unsigned(globalOpts[gMergeStreams]);
+    sets.mergeMemory.fromCache = globalOpts[gMergeFromCache] != 0;
+    sets.shards = globalOpts[gShards];
+    sets.packThreads = unsigned(globalOpts[gPackThreads]);
+    sets.telemetry.prefix = telemetryPrefix;
+    sets.telemetry.everyQueries = globalOpts[gTelemetryQueries];
+    sets.snapshots.save = cacheSavePrefix;
+    sets.snapshots.load = cacheLoadPrefix;
+    sets.reportMemory = globalOpts[gMemoryReport] != 0;
+    sets.memory.adaptive = globalOpts[gAdaptiveMemory] != 0;
+    sets.evictionOrder = globalOpts[gEvictionOrder] ? BenefitPerIO : LargestIdFirst;
+    sets.flushPostings = globalOpts[gFlushKPostings] * 1000;
+    sets.packPolicies.reevaluateEvictions = globalOpts[gPackPolicyPeriod];
+    sets.filterBitsPerKey = globalOpts[gFilterBits];
+    sets.compression.codec = Codec(std::min<uint64_t>(globalOpts[gCodec], BitPacked));
+    sets.coherence = CacheCoherence(std::min<uint64_t>(globalOpts[gCoherence], RefreshStale));
+    sets.cacheTier.postings = globalOpts[gTierMPostings] * 1000000;
+    sets.cacheTier.inclusion = globalOpts[gTierInclusive] ? InclusiveTier : ExclusiveTier;
+    sets.deletes.perPosting = globalOpts[gDeletesPermille] / 1000.0;
+    sets.deletes.garbageTrigger = globalOpts[gGarbageTriggerPct] / 100.0;
+    if(globalOpts[gMemoryStepPermille])
+        sets.memory.stepPermille = globalOpts[gMemoryStepPermille];
+    if(sets.shards > 1 && sets.replicas) {
+        std::cerr << "Error: shards and replicas cannot be combined" << std::endl;
+        exit(1);
     }
-    else {
-        sets.tpQueries = {
-                11782,11566,11459,11292,
-                11286,11110,11094,11304,
-                11035,11024,11243,11176,
-                11192,11143,11217,11185,
-                11003,11021,11299,11217,
-                10985,11152,11039,11157,
-                11119,10987,11101,11003,
-                11288,11245,11276,11299,
-                11092,11029,11088,11129,
-                11121,11066,11057,11009,
-                11202,11239,11134,11326,
-                10948	
-        };
-        sets.tpUpdates = {
-                195705322,196349764,195399697,194151434,
-                190936261,191261649,190209710,192363674,
-                188647608,188619532,188937977,190359610,
-                190364053,189135695,189732419,189071817,
-                190226539,190044871,190089281,189533200,
-                189405216,188879566,188910233,189048263,
-                189482970,189194333,189319583,188629060,
-                189130332,188608975,188784441,188856017,
-                188622468,188843689,188692968,188603141,
-                188582983,188682550,188553502,188609506,
-                188603367,188585978,188573692,188582030,
-                188599756,
-        };
-        sets.tpMembers = {
-                8, 12, 15, 18,
-                21,25,29,34,
-                37,41,46,51,
-                57, 64,71,79,
-                87,96,106,116,
-                128,141,156,174,
-                192,212,231,252,
-                288,328,381,444,
-                532,637,757,924,
-                1213,1704,2583,4273,
-                7605,15724,43332,230072,
-                57503262	
-        };
+    if(!workloadFile.empty()) {
+        try {
+            sets.workload = Profiles::workload(workloadFile);
+            WorkloadClock().init(sets); //fails here rather than in every simulation
+        }
+        catch (std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(1);
+        }
     }
     return sets;
 }